@@ -53,6 +53,11 @@ uint32_t const DDS_SURFACE_FLAGS_TEXTURE        = 0x00001000; // DDSCAPS_TEXTURE
 uint32_t const DDS_RESOURCE_DIMENSION_TEXTURE2D = 3;
 
 bool SaveDDS( char const* path, unsigned format, unsigned texelSizeInBytes, unsigned width, unsigned height, void const* data )
+{
+    return SaveDDSArray( path, format, texelSizeInBytes, width, height, 1, data );
+}
+
+bool SaveDDSArray( char const* path, unsigned format, unsigned texelSizeInBytes, unsigned width, unsigned height, unsigned arraySize, void const* data )
 {
     FILE* f = fopen( path, "wb" );
     if ( !f )
@@ -80,10 +85,10 @@ bool SaveDDS( char const* path, unsigned format, unsigned texelSizeInBytes, unsi
     memset( &hdrDX10, 0, sizeof( hdrDX10 ) );
     hdrDX10.dxgiFormat          = format;
     hdrDX10.resourceDimension   = DDS_RESOURCE_DIMENSION_TEXTURE2D;
-    hdrDX10.arraySize           = 1;
+    hdrDX10.arraySize           = arraySize;
     fwrite( &hdrDX10, sizeof( hdrDX10 ), 1, f );
 
-    fwrite( data, width * height * texelSizeInBytes, 1, f );
+    fwrite( data, width * height * texelSizeInBytes * arraySize, 1, f );
 
     fclose( f );
     return true;
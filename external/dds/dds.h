@@ -3,6 +3,7 @@
 #include <span>
 #include <dds.hpp>
 unsigned const DDS_FORMAT_R32G32B32A32_FLOAT = 2;
+unsigned const DDS_FORMAT_R16G16B16A16_FLOAT = 10;
 unsigned const DDS_FORMAT_R32G32_FLOAT       = 16;
 unsigned const DDS_FORMAT_R16G16_FLOAT       = 34;
 unsigned const DDS_FORMAT_R32_FLOAT          = 41;
@@ -23,4 +24,6 @@ struct DDSImage {
 };
 
 bool SaveDDS( char const* path, unsigned format, unsigned texelSizeInBytes, unsigned width, unsigned height, void const* data );
+// arraySize layers of width * height texels one after the other
+bool SaveDDSArray( char const* path, unsigned format, unsigned texelSizeInBytes, unsigned width, unsigned height, unsigned arraySize, void const* data );
 DDSImage LoadDDS(char const* path);
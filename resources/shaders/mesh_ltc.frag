@@ -3,13 +3,23 @@
 #extension GL_KHR_vulkan_glsl:enable
 
 #define INV_PI 0.31830988618f
-#define LUT_SIZE 64.f
 #define MAX_LIGHT_VERTEX 10
 #define MAX_BEZIER_CURVE 5
 #define MAX_STACK_SIZE 12
 #define EPS 1.0e-5
 #define MIN_THRESHOLD 0.01
 #define CLIP 1
+// light atlas prefiltering, LIGHT_BASE_SIGMA matches SceneLight::m_BlurSigma
+#define LIGHT_FOOTPRINT_SCALE 256.0
+#define LIGHT_BASE_SIGMA 2.0
+//packed scalar layer, also defined in material.h
+#define SCALAR_LAYER 2.0
+#define ROUGHNESS_CHANNEL r
+#define METALLIC_CHANNEL g
+#define AO_CHANNEL b
+//layers of ltc_packed.dds
+#define LTC_MATRIX_LAYER 0.0
+#define LTC_AMP_LAYER 1.0
 //struct
 struct LightInfo {
 	vec2 boundUV[4]; // use for texture
@@ -28,9 +38,8 @@ layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 viewProjMat;
 } u_CamUBO;
 
-layout(set = 1, binding = 5) uniform sampler2D LTCSampler;
-layout(set = 1, binding = 6) uniform sampler2D LTCAmpSampler;
-layout(set = 1, binding = 7) uniform sampler2DArray compressedSampler;
+layout(set = 1, binding = 5) uniform sampler2DArray LTCSampler;
+layout(set = 1, binding = 6) uniform sampler2DArray compressedSampler;
 layout(set = 2, binding = 0) uniform LightCount{
 	uint lightCount;
 };
@@ -38,7 +47,7 @@ layout(set = 2, binding = 1) buffer lightBuffer{
 	LightInfo lightInfos[];
 };
 
-layout(set = 2, binding = 2) uniform sampler2DArray lightAtlasTexture;
+layout(set = 2, binding = 2) uniform sampler2D lightAtlasTexture;
 
 layout(set = 3, binding = 0) uniform MaterialParam{
 	vec4 materialParam;
@@ -57,20 +66,22 @@ layout (location = 0) in PerVertexData{
 layout (location = 0) out vec4 fs_Color;
 
 //Tool function
+//reproject uv to the texel centers of the table eg. for roughness = 1 and a 64x64 table, u should be 63.5/64;
+//the size is read from the texture, the file and the embedded table can have any resolution
+vec2 LTCTexelUV(vec2 uv){
+	float lutSize = float(textureSize(LTCSampler, 0).x);
+	return uv * (lutSize - 1) / lutSize + 0.5 / lutSize;
+}
 vec2 GetFrenselTerm(vec3 V, vec3 N, float roughness){
 	float theta = acos(max(dot(V,N),0));
-	vec2 uv = vec2(roughness, 2 * theta * INV_PI);
-	//reproject uv to 64x64 texture eg. for roughness = 1, u should be 63.5/64;
-	uv = uv * (LUT_SIZE - 1)/LUT_SIZE  + 0.5 / LUT_SIZE;
+	vec2 uv = LTCTexelUV(vec2(roughness, 2 * theta * INV_PI));
 
-	return texture(LTCAmpSampler, uv).xy;
+	return texture(LTCSampler, vec3(uv, LTC_AMP_LAYER)).xy;
 }
 mat3 LTCMatrix(vec3 V, vec3 N, float roughness){
 	float theta = acos(max(dot(V,N),0));
-	vec2 uv = vec2(roughness, 2 * theta * INV_PI);
-	//reproject uv to 64x64 texture eg. for roughness = 1, u should be 63.5/64;
-	uv = uv * (LUT_SIZE - 1)/LUT_SIZE  + 0.5 / LUT_SIZE;
-	vec4 ltcVal = texture(LTCSampler, uv);
+	vec2 uv = LTCTexelUV(vec2(roughness, 2 * theta * INV_PI));
+	vec4 ltcVal = texture(LTCSampler, vec3(uv, LTC_MATRIX_LAYER));
 
 	mat3 res = mat3(
 		vec3(ltcVal.x,0,ltcVal.z),
@@ -128,7 +139,10 @@ void FetchLight(vec3 v[4],  vec2 uvs[4], vec3 lookup, out vec2 uv, out float lod
 	barycentric /= (barycentric.x + barycentric.y + barycentric.z + barycentric.w);
 
 	//OUTPUT
-	lod = log(2048.0 * dist / pow(A, 0.5)) / log(3.0);//magic
+	// footprint blur in light texels grows with dist / sqrt(A), mip i >= 1 of the light atlas is blurred by LIGHT_BASE_SIGMA * 2^i
+	// texels and mip 0 is unfiltered, below the blur of mip 1 the lod blends linearly from the sharp level
+	float blurInSigma = LIGHT_FOOTPRINT_SCALE * dist / (LIGHT_BASE_SIGMA * pow(A, 0.5));
+	lod = (blurInSigma < 2.0 ? 0.5 * blurInSigma : log2(blurInSigma));
 	uv = uvs[0] * barycentric.x + uvs[1] * barycentric.y + uvs[2] * barycentric.z + uvs[3] * barycentric.w;
 }
 
@@ -619,11 +633,13 @@ void main(){
 	vec3 V = normalize(cameraPos - pos);
 	vec3 N = normalize(fs_norm);
 
-	float roughness = texture(compressedSampler, vec3(fragIn.uv, 2.0)).r;
+	vec4 scalars = texture(compressedSampler, vec3(fragIn.uv, SCALAR_LAYER));
+	float roughness = scalars.ROUGHNESS_CHANNEL;
 	//roughness += 
 	//roughness = clamp(roughness , 0.1f, 0.99f);//fix visual artifact when roughness is 1.0
 	//roughness = materialParam.x;
-	float metallic = texture(compressedSampler, vec3(fragIn.uv, 3.0)).r;
+	float metallic = scalars.METALLIC_CHANNEL;
+	float ao = scalars.AO_CHANNEL;
 
 	mat3 LTCMat = LTCMatrix(V, N, roughness);
 	vec2 fresnelWeight = GetFrenselTerm(V,N,roughness);
@@ -652,12 +668,12 @@ void main(){
 			//vec3 spec = vec3(d * (F + fresnelWeight.y/F - fresnelWeight.y));
 			vec3 spec = vec3(F0 * fresnelWeight.x + (1 - F0) * fresnelWeight.y) * d;
 			//apply light texture
-			spec *= mix(texture(lightAtlasTexture,vec3(ltuv,ceil(lod))).xyz, texture(lightAtlasTexture,vec3(ltuv,floor(lod))).xyz, ceil(lod) - lod);
+			spec *= textureLod(lightAtlasTexture, ltuv, lod).xyz;
 			spec = max(spec, 0.f);
 
 			d = IntegrateD(I, V, N, pos, lightInfo, doubleSide, ltuv, lod) * lightInfo.amplitude;
 			//apply light texture
-			vec3 diffuse = d * mix(texture(lightAtlasTexture,vec3(ltuv,ceil(lod))).xyz, texture(lightAtlasTexture,vec3(ltuv,floor(lod))).xyz, ceil(lod) - lod);
+			vec3 diffuse = d * textureLod(lightAtlasTexture, ltuv, lod).xyz;
 			diffuse = max(diffuse, vec3(0.f)) * (1.f - metallic);
 
 			fs_Color += vec4(mix(diffuse, spec, F0), 0.f);
@@ -669,12 +685,12 @@ void main(){
 			float d = IntegrateBezierD(LTCMat, V, N, pos, roughness, lightInfo, doubleSide, ltuv, lod) * lightInfo.amplitude;
 			vec3 spec = vec3(F0 * fresnelWeight.x + (1 - F0) * fresnelWeight.y) * d;
 			//apply texture
-			spec *= mix(texture(lightAtlasTexture,vec3(ltuv,ceil(lod))).xyz, texture(lightAtlasTexture,vec3(ltuv,floor(lod))).xyz, ceil(lod) - lod);
+			spec *= textureLod(lightAtlasTexture, ltuv, lod).xyz;
 			spec = max(spec, 0.f);
 
 			d = IntegrateBezierD(I, V, N, pos, roughness, lightInfo, doubleSide, ltuv, lod) * lightInfo.amplitude;
 			//apply light texture
-			vec3 diffuse = d * mix(texture(lightAtlasTexture,vec3(ltuv,ceil(lod))).xyz, texture(lightAtlasTexture,vec3(ltuv,floor(lod))).xyz, ceil(lod) - lod);
+			vec3 diffuse = d * textureLod(lightAtlasTexture, ltuv, lod).xyz;
 			diffuse = max(diffuse, vec3(0.f)) * (1.f - metallic);
 
 			fs_Color += vec4(mix(diffuse, spec, F0), 0.f);
@@ -682,7 +698,7 @@ void main(){
 	}
 	 // fs_Color.xyz = N;
 	// fs_Color.xyz = vec3(dot(V, N));
-	fs_Color += 0.1;
+	fs_Color += 0.1 * ao;
 	fs_Color *= albedo;
 	fs_Color = (fs_Color) / (fs_Color + 1.f);
 
@@ -44,10 +44,10 @@ namespace CUDA_Helper
 		}
 
 		uchar4 result;
-		result.x = static_cast<unsigned char>(pixel_sum.x / weight_sum);
-		result.y = static_cast<unsigned char>(pixel_sum.y / weight_sum);
-		result.z = static_cast<unsigned char>(pixel_sum.z / weight_sum);
-		result.w = static_cast<unsigned char>(pixel_sum.w / weight_sum);
+		result.x = static_cast<unsigned char>(pixel_sum.x / weight_sum + 0.5f);
+		result.y = static_cast<unsigned char>(pixel_sum.y / weight_sum + 0.5f);
+		result.z = static_cast<unsigned char>(pixel_sum.z / weight_sum + 0.5f);
+		result.w = static_cast<unsigned char>(pixel_sum.w / weight_sum + 0.5f);
 		out_image[index] = result;
 	}
 
@@ -0,0 +1,106 @@
+#include "threadPool.h"
+
+namespace MyCore
+{
+	ThreadPool::ThreadPool(uint32_t const& threadCount)
+	{
+		uint32_t count = (threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		m_Workers.reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			b_Stop = true;
+		}
+		m_Condition.notify_all();
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool& ThreadPool::GetInstance()
+	{
+		static ThreadPool s_Instance;
+		return s_Instance;
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this]() { return b_Stop || !m_Tasks.empty(); });
+				if (b_Stop && m_Tasks.empty()) return;
+
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop();
+			}
+			task();
+		}
+	}
+
+	struct ParallelForState
+	{
+		std::function<void(uint32_t)> func;
+		uint32_t end;
+		std::atomic<uint32_t> next;
+		std::atomic<uint32_t> remaining;
+
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::exception_ptr exception;
+
+		void Run()
+		{
+			for (uint32_t i = next++; i < end; i = next++)
+			{
+				try
+				{
+					func(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!exception) exception = std::current_exception();
+				}
+				if (--remaining == 0)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					finished.notify_all();
+				}
+			}
+		}
+	};
+
+	void ThreadPool::ParallelFor(uint32_t const& begin, uint32_t const& end, std::function<void(uint32_t)> const& func)
+	{
+		if (begin >= end) return;
+
+		auto state = std::make_shared<ParallelForState>();
+		state->func = func;
+		state->end = end;
+		state->next = begin;
+		state->remaining = end - begin;
+
+		// helpers only pick up indices that are left, so the caller never waits on a queued helper
+		uint32_t helper_count = std::min(GetThreadCount(), end - begin - 1);
+		for (uint32_t i = 0; i < helper_count; ++i)
+		{
+			Submit([state]() { state->Run(); });
+		}
+		state->Run();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [&state]() { return state->remaining == 0; });
+		if (state->exception) std::rethrow_exception(state->exception);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace MyCore
+{
+	class ThreadPool
+	{
+	public:
+		// threadCount of 0 uses the hardware concurrency
+		ThreadPool(uint32_t const& threadCount = 0);
+		~ThreadPool();
+
+		template<typename Func>
+		auto Submit(Func&& func) -> std::future<std::invoke_result_t<Func>>
+		{
+			using Result = std::invoke_result_t<Func>;
+
+			// packaged_task is move only, share it so the queue can hold a std::function
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+			std::future<Result> result = task->get_future();
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Tasks.emplace([task]() { (*task)(); });
+			}
+			m_Condition.notify_one();
+			return result;
+		}
+
+		// Run func(i) for every i in [begin, end), the calling thread takes part in the work.
+		// Safe to call from inside a pool task.
+		void ParallelFor(uint32_t const& begin, uint32_t const& end, std::function<void(uint32_t)> const& func);
+
+		inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+		static ThreadPool& GetInstance();
+
+	protected:
+		void WorkerLoop();
+
+	protected:
+		std::vector<std::thread> m_Workers;
+		std::queue<std::function<void()>> m_Tasks;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool b_Stop{ false };
+	};
+}
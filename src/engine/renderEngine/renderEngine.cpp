@@ -102,6 +102,16 @@ namespace VK_Renderer
 		m_Device->GetDevice().resetFences(m_Fences[image_idx].get());
 	}
 
+	void VK_RenderEngine::WaitForInFlightFrames() const
+	{
+		std::vector<vk::Fence> fences;
+		for (vk::UniqueFence const& fence : m_Fences)
+		{
+			fences.push_back(fence.get());
+		}
+		m_Device->GetDevice().waitForFences(fences, vk::True, std::numeric_limits<uint64_t>().max());
+	}
+
 	void VK_RenderEngine::RecordCommandBuffer()
 	{
 		static std::array<vk::ClearValue, 3> clear_color{};
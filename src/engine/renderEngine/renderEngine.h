@@ -61,6 +61,8 @@ namespace VK_Renderer
 		inline void AddRenderFinishSemasphore(vk::Semaphore const& semaphore) { m_RenderFinishSemaphores.push_back(semaphore); }
 
 		void WaitForFence();
+		// Wait until no submitted frame is running, before resources the frames read are written
+		void WaitForInFlightFrames() const;
 
 		void BeforeRender();
 		void Render();
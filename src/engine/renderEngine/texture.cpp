@@ -60,7 +60,7 @@ namespace VK_Renderer
 		// Create Image View
 		vk_ImageView = m_Device.GetDevice().createImageView(vk::ImageViewCreateInfo{
 			.image = vk_Image,
-			.viewType = vk::ImageViewType::e2D,
+			.viewType = (vk_SubresourceRange.layerCount > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D),
 			.format = vk_Format,
 			.subresourceRange = vk_SubresourceRange,
 		});
@@ -74,12 +74,44 @@ namespace VK_Renderer
 	void VK_Texture2D::CreateFromImage(Image const& image, 
 										TextureCreateInfo const& createInfo)
 	{
-		CreateFromData(image.GetRawData(), image.GetSize() , 
-			{ 
+		// dds images carry their own format, mips and layers
+		TextureCreateInfo image_info = createInfo;
+		if (image.GetFormat() != vk::Format::eUndefined) image_info.format = image.GetFormat();
+		image_info.mipLevel = image.GetMipCount();
+		image_info.arrayLayer = image.GetLayerCount();
+
+		Create({
 				static_cast<uint32_t>(image.GetResolution().x),
 				static_cast<uint32_t>(image.GetResolution().y),
 				1
-			}, createInfo);
+			}, image_info, image.GetSize());
+		TransitionLayout(VK_ImageLayout{
+			.layout = vk::ImageLayout::eTransferDstOptimal,
+			.accessFlag = vk::AccessFlagBits::eMemoryWrite,
+			.pipelineStage = vk::PipelineStageFlagBits::eTransfer,
+			});
+
+		// one staging copy of the file data, each mip of each layer is its own region
+		std::vector<vk::BufferImageCopy> regions;
+		for (ImageSubresource const& subresource : image.GetSubresources())
+		{
+			regions.push_back(vk::BufferImageCopy{
+				.bufferOffset = subresource.offset,
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = vk::ImageSubresourceLayers{
+					.aspectMask = vk_SubresourceRange.aspectMask,
+					.mipLevel = subresource.mipLevel,
+					.baseArrayLayer = subresource.arrayLayer,
+					.layerCount = 1
+				},
+				.imageOffset = { 0, 0, 0 },
+				.imageExtent = { static_cast<uint32_t>(subresource.extent.x), static_cast<uint32_t>(subresource.extent.y), 1 }
+			});
+		}
+		CopyFromRegions(image.GetRawData(), vk_Size, regions);
+
+		CreateSampler();
 	}
 
 	void VK_Texture2D::CreateFromData(void const* data, uint32_t const& size, vk::Extent3D const& extent, TextureCreateInfo const& createInfo)
@@ -92,6 +124,11 @@ namespace VK_Renderer
 			});
 		CopyFrom(data);
 
+		CreateSampler();
+	}
+
+	void VK_Texture2D::CreateSampler()
+	{
 		vk::PhysicalDeviceProperties property = m_Device.GetPhysicalDevice().getProperties();
 
 		// Create Sampler
@@ -107,7 +144,7 @@ namespace VK_Renderer
 			.maxAnisotropy = property.limits.maxSamplerAnisotropy,
 			.compareEnable = vk::False,
 			.minLod = 0.f,
-			.maxLod = 0.f,
+			.maxLod = static_cast<float>(vk_SubresourceRange.levelCount - 1),
 			.borderColor = vk::BorderColor::eIntOpaqueBlack,
 			.unnormalizedCoordinates = vk::False
 		});
@@ -185,6 +222,39 @@ namespace VK_Renderer
 		m_Device.GetTransferQueue().waitIdle();
 		staging_buffer.Free();
 	}
+
+	void VK_Texture2D::UpdateRegions(void const* data, vk::DeviceSize const& size, std::vector<vk::BufferImageCopy> const& regions)
+	{
+		if (regions.empty()) return;
+
+		VK_ImageLayout previous_layout = m_Layout;
+		TransitionLayout(VK_ImageLayout{
+			.layout = vk::ImageLayout::eTransferDstOptimal,
+			.accessFlag = vk::AccessFlagBits::eTransferWrite,
+			.pipelineStage = vk::PipelineStageFlagBits::eTransfer,
+		});
+		CopyFromRegions(data, size, regions);
+		TransitionLayout(previous_layout);
+	}
+
+	void VK_Texture2D::CopyFromRegions(void const* data, vk::DeviceSize const& size, std::vector<vk::BufferImageCopy> const& regions)
+	{
+		VK_StagingBuffer staging_buffer(m_Device);
+		staging_buffer.CreateFromData(data, size, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive);
+
+		VK_CommandBuffer cmd = m_Device.GetTransferCommandPool()->AllocateCommandBuffers();
+		cmd.Begin({ .usage = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+		cmd[0].copyBufferToImage(staging_buffer.GetBuffer(), vk_Image, m_Layout.layout, regions);
+		cmd.End();
+
+		m_Device.GetTransferQueue().submit(vk::SubmitInfo{
+			.commandBufferCount = 1,
+			.pCommandBuffers = &(cmd[0])
+		});
+
+		m_Device.GetTransferQueue().waitIdle();
+		staging_buffer.Free();
+	}
 	
 	void VK_Texture2D::CopyTo(void* data)
 	{
@@ -273,14 +343,16 @@ namespace VK_Renderer
 			.pipelineStage = vk::PipelineStageFlagBits::eTransfer,
 			});
 		
-		void* tmp_raw_data = malloc(vk_Size);
+		// write every layer straight into the staging buffer, no intermediate copy
+		VK_StagingBuffer staging_buffer(m_Device);
+		staging_buffer.Create(vk_Size, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive);
 		size_t offset = 0;
 		for (size_t i = 0;i < images.size();++i) {
-			std::memcpy((uint8_t*)tmp_raw_data + offset,images[i].GetRawData(), images[i].GetSize());
+			staging_buffer.Update(images[i].GetRawData(), offset, images[i].GetSize());
 			offset += images[i].GetSize();
 		}
-		CopyFrom(tmp_raw_data,image.GetResolution().x, image.GetResolution().y);
-		free(tmp_raw_data);
+		CopyFromStaging(staging_buffer, image.GetResolution().x, image.GetResolution().y, 4);
+		staging_buffer.Free();
 
 		vk::PhysicalDeviceProperties property = m_Device.GetPhysicalDevice().getProperties();
 
@@ -379,7 +451,10 @@ namespace VK_Renderer
 	void VK_Texture2DArray::CopyFrom(void const* data, int width, int height, int channel, vk::Offset3D const& offset) {
 		VK_StagingBuffer staging_buffer(m_Device);
 		staging_buffer.CreateFromData(data, vk_Size, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive);
-
+		CopyFromStaging(staging_buffer, width, height, channel);
+		staging_buffer.Free();
+	}
+	void VK_Texture2DArray::CopyFromStaging(VK_StagingBuffer const& staging_buffer, int width, int height, int channel) {
 		VK_CommandBuffer cmd = m_Device.GetTransferCommandPool()->AllocateCommandBuffers();
 
 		cmd.Begin({ .usage = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
@@ -407,7 +482,6 @@ namespace VK_Renderer
 			});
 
 		m_Device.GetTransferQueue().waitIdle();
-		staging_buffer.Free();
 	}
 	//TODO
 	void VK_Texture2DArray::CopyTo(void* data)
@@ -5,6 +5,7 @@
 namespace VK_Renderer
 {
 	class VK_Device;
+	class VK_StagingBuffer;
 	class Image;
 
 	struct VK_ImageLayout
@@ -36,6 +37,7 @@ namespace VK_Renderer
 					TextureCreateInfo const& createInfo,
 					uint32_t const& size = 0);
 
+		// for dds files the format, mips and layers come from the file, createInfo.format is ignored
 		void CreateFromFile(std::string const& file,
 							TextureCreateInfo const& createInfo);
 		void CreateFromImage(Image const& image, 
@@ -51,8 +53,16 @@ namespace VK_Renderer
 		void TransitionLayout(VK_ImageLayout const& targetLayout);
 
 		void CopyFrom(void const* data, vk::Offset3D const& = {0, 0, 0});
+		// Copy parts of mips from data (size bytes) after creation, the layout is restored afterwards.
+		// Runs on the transfer queue without synchronizing with the frames, the caller has to make sure
+		// no submitted frame still reads the image (VK_RenderEngine::WaitForInFlightFrames).
+		void UpdateRegions(void const* data, vk::DeviceSize const& size, std::vector<vk::BufferImageCopy> const& regions);
 		void CopyTo(void* data);
 
+	protected:
+		void CopyFromRegions(void const* data, vk::DeviceSize const& size, std::vector<vk::BufferImageCopy> const& regions);
+		void CreateSampler();
+
 	protected:
 		VK_Device const& m_Device;
 		vk::UniqueDeviceMemory vk_DeviceMemory;
@@ -94,6 +104,9 @@ namespace VK_Renderer
 		void CopyFrom(void const* data, int width, int height, int channel = 4, vk::Offset3D const& = { 0, 0, 0 });
 		void CopyTo(void* data);
 
+	protected:
+		void CopyFromStaging(VK_StagingBuffer const& stagingBuffer, int width, int height, int channel);
+
 	protected:
 		VK_Device const& m_Device;
 		vk::UniqueDeviceMemory vk_DeviceMemory;
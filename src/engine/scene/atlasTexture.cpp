@@ -1,9 +1,10 @@
 #include "atlasTexture.h"
+#include "pixelBufferPool.h"
 
 namespace VK_Renderer
 {
 	AtlasTexture2D::AtlasTexture2D(AtlasTexture2DCreateInfo const& info)
-		:m_Channels(info.channels)
+		:m_Channels(info.channels), m_ChannelSize(info.channelSize), m_BlockAlignment(std::max(info.blockAlignment, 1u)), m_LayerCount(0)
 	{
 	}
 
@@ -22,6 +23,7 @@ namespace VK_Renderer
 	void AtlasTexture2D::Free()
 	{
 		m_Size = 0;
+		m_LayerCount = 0;
 		m_Data.clear();
 		m_FinishedAtlas.clear();
 	}
@@ -41,15 +43,46 @@ namespace VK_Renderer
 		Free();
 		if (materials.size() == 0) return;
 
-		m_FinishedAtlas.resize(materials.size());
+		std::vector<glm::ivec2> resolutions;
+		for (Material const& material : materials)
+		{
+			glm::ivec2 resolution(0);
+			for (Image const& image : material.GetTextures())
+			{
+				if (!AcceptsFormat(image.GetFormat())) continue;
+				glm::ivec2 dim(image.GetResolution());
+				if (dim.x * dim.y > resolution.x * resolution.y) resolution = dim;
+			}
+			resolutions.emplace_back(resolution);
+		}
+		ComputeLayout(resolutions, materials[0].GetTextures().size());
+
+		for (size_t i = 0; i < materials.size(); ++i)
+		{
+			CopyMaterial(i, materials[i]);
+		}
+	}
+
+	void AtlasTexture2D::ComputeLayout(std::vector<glm::ivec2> const& resolutions, uint32_t const& layerCount)
+	{
+		Free();
+		if (resolutions.size() == 0) return;
+
+		m_FinishedAtlas.resize(resolutions.size());
+
+		// blocks are placed by their footprint, rounded up to the alignment
+		uint32_t alignment = m_BlockAlignment;
+		auto get_footprint = [alignment](glm::ivec2 const& dim) {
+			return glm::ivec2((dim.x + alignment - 1) / alignment * alignment, (dim.y + alignment - 1) / alignment * alignment);
+		};
 
 		TextureBlock2D init_blocks;
 
 		std::vector<MaterialProxy> sorted_materials;
 
-		for (size_t i = 0; i < materials.size(); ++i)
+		for (size_t i = 0; i < resolutions.size(); ++i)
 		{
-			glm::ivec3 const& dim = materials[i].GetTextures()[0].GetResolution();
+			glm::ivec2 dim = get_footprint(resolutions[i]);
 			
 			init_blocks.width += dim.x;
 			init_blocks.height += dim.y;
@@ -65,7 +98,7 @@ namespace VK_Renderer
 
 		for (auto const& material_proxy : sorted_materials)
 		{
-			glm::ivec3 const& dim = materials[material_proxy.id].GetTextures()[0].GetResolution();
+			glm::ivec2 dim = get_footprint(resolutions[material_proxy.id]);
 			
 			std::list<TextureBlock2D>::iterator best_block_it = avaliable_blocks.end();
 			auto it = avaliable_blocks.begin();
@@ -86,19 +119,19 @@ namespace VK_Renderer
 			// Step 1. Add a new atlas finished list
 			m_FinishedAtlas[material_proxy.id] = TextureBlock2D{
 				.start = best_block_it->start,
-				.width = static_cast<unsigned int>(dim.x),
-				.height = static_cast<unsigned int>(dim.y),
+				.width = static_cast<unsigned int>(resolutions[material_proxy.id].x),
+				.height = static_cast<unsigned int>(resolutions[material_proxy.id].y),
 			};
 			// compute some necessary data
 			glm::ivec2 end = best_block_it->start + glm::ivec2{ dim.x, dim.y };
 
 			unsigned int w = best_block_it->width - dim.x;
 			unsigned int h = best_block_it->height - dim.y;
-			// Step 2. Add splited atlas into aviable set
+			// Step 2. Add splited atlas into aviable set, right of, below and diagonal to the new block
 			if (w > 0)
 			{
 				avaliable_blocks.push_back(TextureBlock2D{
-					.start = best_block_it->start + glm::ivec2{0, dim.y},
+					.start = best_block_it->start + glm::ivec2{dim.x, 0},
 					.width = w,
 					.height = static_cast<unsigned int>(dim.y),
 				});
@@ -106,7 +139,7 @@ namespace VK_Renderer
 			if (h > 0)
 			{
 				avaliable_blocks.push_back(TextureBlock2D{
-					.start = best_block_it->start + glm::ivec2{dim.x, 0},
+					.start = best_block_it->start + glm::ivec2{0, dim.y},
 					.width = static_cast<unsigned int>(dim.x),
 					.height = h,
 				});
@@ -126,51 +159,104 @@ namespace VK_Renderer
 			avaliable_blocks.erase(best_block_it);
 		}
 
-		// copy texture data
-		m_Data.resize(m_Resolution.x * m_Resolution.y * m_Channels * materials[0].GetTextures().size());
+		m_LayerCount = layerCount;
+		m_Data.resize(m_Resolution.x * m_Resolution.y * GetTexelSize() * m_LayerCount);
 		
 		m_Size = m_Data.size() * sizeof(unsigned char);
+	}
 
-		for (size_t i = 0; i < m_FinishedAtlas.size(); ++i)
+	void AtlasTexture2D::CopyMaterial(uint32_t const& id, Material const& material)
+	{
+		for (size_t k = 0; k < material.GetTextures().size(); ++k)
 		{
-			TextureBlock2D const& atlas = m_FinishedAtlas[i];
-			Material const& material = materials[i];
+			Image const& image = material.GetTextures()[k];
+			if (image.GetSize() > 0) CopyImage(id, k, image);
+		}
+	}
+
+	bool AtlasTexture2D::AcceptsFormat(vk::Format const& format) const
+	{
+		if (m_Channels != 4) return false;
+		if (m_ChannelSize == 2) return format == vk::Format::eR16G16B16A16Sfloat;
+		return m_ChannelSize == 1 && (format == vk::Format::eUndefined || format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb);
+	}
+
+	bool AtlasTexture2D::CopyImage(uint32_t const& id, uint32_t const& layer, PixelView const& image)
+	{
+		TextureBlock2D const& atlas = m_FinishedAtlas[id];
+		glm::ivec3 const& dim = image.resolution;
+		uint32_t texel_size = GetTexelSize();
+		// only the first level of a dds is read, the buffer may hold more
+		if (!AcceptsFormat(image.format) || dim.x <= 0 || dim.y <= 0 ||
+			image.size < static_cast<uint64_t>(dim.x) * dim.y * texel_size) return false;
 
-			uint32_t start = (atlas.start.y * (m_Resolution.x) + atlas.start.x) * m_Channels;
-			uint32_t size = atlas.width * m_Channels * sizeof(unsigned char);
+		uint64_t layer_offset = static_cast<uint64_t>(layer) * m_Resolution.x * m_Resolution.y * texel_size;
+		uint32_t start = (atlas.start.y * (m_Resolution.x) + atlas.start.x) * texel_size;
+		uint32_t size = atlas.width * texel_size * sizeof(unsigned char);
+		unsigned char* dst = m_Data.data() + layer_offset + start;
+		unsigned char const* data = reinterpret_cast<unsigned char const*>(image.data);
+		PixelBufferPool::GetInstance().RecordCopy(static_cast<uint64_t>(atlas.width) * atlas.height * texel_size);
 
-			for (size_t k = 0; k < material.GetTextures().size(); ++k)
+		if (dim.x == atlas.width && dim.y == atlas.height)
+		{
+			for (uint32_t h = 0; h < atlas.height; ++h)
 			{
-				uint64_t layer_offset = k * m_Resolution.x * m_Resolution.y * m_Channels;
-				Image const& image = material.GetTextures()[k];
-				if (image.GetSize() > 0)
-				{
-					if (image.GetResolution().x == 1 && image.GetResolution().y == 1)
-					{
-						// special case that texture is a 1x1 image
-						unsigned char const* data = reinterpret_cast<unsigned char*>(image.GetRawData());
-						for (uint32_t h = 0; h < atlas.height; ++h)
-						{
-							uint32_t copy_start = start + h * m_Resolution.x * m_Channels;
-							for (int pixel = 0; pixel < atlas.width; ++pixel)
-							{
-								*(m_Data.data() + layer_offset + copy_start + pixel * 3) = data[0];
-								*(m_Data.data() + layer_offset + copy_start + pixel * 3 + 1) = data[1];
-								*(m_Data.data() + layer_offset + copy_start + pixel * 3 + 2) = data[2];
-							}
-						}
-					}
-					else
-					{
-						unsigned char const* data = reinterpret_cast<unsigned char*>(image.GetRawData());
-						for (uint32_t h = 0; h < atlas.height; ++h)
-						{
-							uint32_t copy_start = start + h * m_Resolution.x * m_Channels;
-							std::memcpy(m_Data.data() + layer_offset + copy_start, data + h * size, size);
-						}
-					}
-				}
-				
+				std::memcpy(dst + h * m_Resolution.x * texel_size, data + h * size, size);
+			}
+			return true;
+		}
+
+		// different size (e.g. a 1x1 constant texture), resample
+		for (uint32_t h = 0; h < atlas.height; ++h)
+		{
+			uint32_t src_y = h * dim.y / atlas.height;
+			for (uint32_t w = 0; w < atlas.width; ++w)
+			{
+				uint32_t src_x = w * dim.x / atlas.width;
+				std::memcpy(dst + (h * m_Resolution.x + w) * texel_size, data + (src_y * dim.x + src_x) * texel_size, texel_size);
+			}
+		}
+		return true;
+	}
+
+	bool AtlasTexture2D::CopyChannel(uint32_t const& id, uint32_t const& layer, uint8_t const& channel, PixelView const& image)
+	{
+		TextureBlock2D const& atlas = m_FinishedAtlas[id];
+		glm::ivec3 const& dim = image.resolution;
+		if (m_ChannelSize != 1 || !AcceptsFormat(image.format) || dim.x <= 0 || dim.y <= 0 ||
+			image.size < static_cast<uint64_t>(dim.x) * dim.y * m_Channels) return false;
+
+		uint64_t layer_offset = static_cast<uint64_t>(layer) * m_Resolution.x * m_Resolution.y * m_Channels;
+		uint32_t start = (atlas.start.y * (m_Resolution.x) + atlas.start.x) * m_Channels;
+		unsigned char* dst = m_Data.data() + layer_offset + start + channel;
+		unsigned char const* data = reinterpret_cast<unsigned char const*>(image.data);
+		PixelBufferPool::GetInstance().RecordCopy(static_cast<uint64_t>(atlas.width) * atlas.height);
+
+		for (uint32_t h = 0; h < atlas.height; ++h)
+		{
+			uint32_t src_y = h * dim.y / atlas.height;
+			for (uint32_t w = 0; w < atlas.width; ++w)
+			{
+				uint32_t src_x = w * dim.x / atlas.width;
+				dst[(h * m_Resolution.x + w) * m_Channels] = data[(src_y * dim.x + src_x) * m_Channels];
+			}
+		}
+		return true;
+	}
+
+	void AtlasTexture2D::FillChannel(uint32_t const& id, uint32_t const& layer, uint8_t const& channel, uint8_t const& value)
+	{
+		TextureBlock2D const& atlas = m_FinishedAtlas[id];
+
+		uint64_t layer_offset = static_cast<uint64_t>(layer) * m_Resolution.x * m_Resolution.y * m_Channels;
+		uint32_t start = (atlas.start.y * (m_Resolution.x) + atlas.start.x) * m_Channels;
+		unsigned char* dst = m_Data.data() + layer_offset + start + channel;
+
+		for (uint32_t h = 0; h < atlas.height; ++h)
+		{
+			for (uint32_t w = 0; w < atlas.width; ++w)
+			{
+				dst[(h * m_Resolution.x + w) * m_Channels] = value;
 			}
 		}
 	}
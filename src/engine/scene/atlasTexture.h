@@ -22,6 +22,10 @@ namespace VK_Renderer
 	struct AtlasTexture2DCreateInfo
 	{
 		uint8_t channels{ 4 };
+		uint8_t channelSize{ 1 }; // bytes per channel, 2 for half floats
+		// block origins and footprints are multiples of it, with 2^(n - 1) the blocks of a pyramid of n
+		// levels never share a texel. The block keeps its own size, the rest of the footprint stays empty.
+		uint32_t blockAlignment{ 1 };
 	};
 
 	class AtlasTexture2D
@@ -35,10 +39,31 @@ namespace VK_Renderer
 		void Free();
 		void ComputeAtlas(std::vector<Material> const& materials);
 
+		// Compute block placement from resolutions only and allocate the layers
+		void ComputeLayout(std::vector<glm::ivec2> const& resolutions, uint32_t const& layerCount);
+		// Copy the textures of a material into its block
+		void CopyMaterial(uint32_t const& id, Material const& material);
+
+		// Copy an image into the block of a layer, resampled with nearest filtering if sizes differ.
+		// Different blocks, layers or channels can be written from different threads.
+		// Returns false and copies nothing if the image is not in the texel format of the atlas.
+		bool CopyImage(uint32_t const& id, uint32_t const& layer, PixelView const& image);
+		inline uint32_t GetTexelSize() const { return m_Channels * m_ChannelSize; }
+		// 8 bit RGBA for 1 byte channels, RGBA16F for 2 byte channels. Block compressed and single
+		// channel images have to be converted before they reach the atlas.
+		bool AcceptsFormat(vk::Format const& format) const;
+
+		// Copy the red channel of an 8 bit RGBA image into one channel of the block, 8 bit channels only
+		bool CopyChannel(uint32_t const& id, uint32_t const& layer, uint8_t const& channel, PixelView const& image);
+		void FillChannel(uint32_t const& id, uint32_t const& layer, uint8_t const& channel, uint8_t const& value);
+
 	protected:
 		DeclareWithGetSetFunc(protected, uint8_t, m, Channels, const);
+		DeclareWithGetSetFunc(protected, uint8_t, m, ChannelSize, const);
+		DeclareWithGetFunc(protected, uint32_t, m, BlockAlignment, const);
 		DeclareWithGetFunc(protected, uint64_t, m, Size, const);
 		DeclareWithGetFunc(protected, glm::ivec2, m, Resolution, const);
+		DeclareWithGetFunc(protected, uint32_t, m, LayerCount, const);
 		DeclareWithGetFunc(protected, std::vector<unsigned char>, m, Data, const);
 		DeclareWithGetFunc(protected, std::vector<TextureBlock2D>, m, FinishedAtlas, const);
 	};
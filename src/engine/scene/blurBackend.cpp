@@ -0,0 +1,110 @@
+#include "blurBackend.h"
+#include "gaussianBlur.h"
+
+#include "core/threadPool.h"
+
+#ifdef ENGINE_WITH_CUDA
+#include <gaussian.cuh>
+#endif
+
+#include <iostream>
+
+namespace VK_Renderer
+{
+	bool BlurBackend::IsAvailable(BlurBackendType const& type)
+	{
+		switch (type)
+		{
+		case BlurBackendType::CPU:
+			return true;
+		case BlurBackendType::CUDA:
+#ifdef ENGINE_WITH_CUDA
+			return true;
+#else
+			return false;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	uPtr<BlurBackend> BlurBackend::Create(BlurBackendType const& type)
+	{
+		uPtr<BlurBackend> cpu_backend = mkU<CPUBlurBackend>();
+		if (type == BlurBackendType::CPU) return cpu_backend;
+
+		uPtr<BlurBackend> backend;
+#ifdef ENGINE_WITH_CUDA
+		if (type == BlurBackendType::CUDA) backend = mkU<CUDABlurBackend>();
+#endif
+		if (!backend)
+		{
+			std::cerr << "Blur backend " << static_cast<int>(type) << " is not built, using the CPU backend" << std::endl;
+			return cpu_backend;
+		}
+
+		// conformance check against the CPU backend, borders included
+		int error = Compare(*cpu_backend, *backend, { 67, 45 }, 8, 3.f);
+		if (error > MaxConformanceError)
+		{
+			std::cerr << "Blur backend " << static_cast<int>(type) << " differs from the CPU backend by " << error << ", using the CPU backend" << std::endl;
+			return cpu_backend;
+		}
+		return backend;
+	}
+
+	int BlurBackend::Compare(BlurBackend& a, BlurBackend& b, glm::ivec2 const& resolution, int const& halfRadius, float const& sigma)
+	{
+		size_t size = static_cast<size_t>(resolution.x) * resolution.y * 4;
+		std::vector<unsigned char> input(size), result_a(size), result_b(size);
+
+		// hash pattern, deterministic and full of edges
+		for (size_t i = 0; i < size; ++i)
+		{
+			uint32_t h = static_cast<uint32_t>(i) * 2654435761u;
+			input[i] = static_cast<unsigned char>((h >> 13) ^ (h >> 24));
+		}
+
+		std::shared_ptr<std::vector<float> const> kernel = GetCachedGaussianKernel1D(halfRadius, sigma);
+		a.Blur(result_a.data(), input.data(), resolution, halfRadius, kernel->data(), BlurBorder::Renormalize);
+		b.Blur(result_b.data(), input.data(), resolution, halfRadius, kernel->data(), BlurBorder::Renormalize);
+
+		int error = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			error = std::max(error, std::abs(static_cast<int>(result_a[i]) - static_cast<int>(result_b[i])));
+		}
+		return error;
+	}
+
+	void CPUBlurBackend::Blur(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+							int const& halfRadius, float const* kernel, BlurBorder const& border)
+	{
+		GaussianBlurSeparable(outImage, inputImage, resolution, halfRadius, kernel, MyCore::ThreadPool::GetInstance(), border);
+	}
+
+#ifdef ENGINE_WITH_CUDA
+	void CUDABlurBackend::Blur(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+							int const& halfRadius, float const* kernel, BlurBorder const& border)
+	{
+		// the cuda kernel only renormalizes at the border, padded borders run on the cpu
+		if (border != BlurBorder::Renormalize)
+		{
+			GaussianBlurSeparable(outImage, inputImage, resolution, halfRadius, kernel, MyCore::ThreadPool::GetInstance(), border);
+			return;
+		}
+
+		// the cuda kernel convolves with the full 2D kernel
+		int kernel_size = 2 * halfRadius + 1;
+		std::vector<float> kernel_2d(kernel_size * kernel_size);
+		for (int y = 0; y < kernel_size; ++y)
+		{
+			for (int x = 0; x < kernel_size; ++x)
+			{
+				kernel_2d[y * kernel_size + x] = kernel[x] * kernel[y];
+			}
+		}
+		CUDA_Helper::GaussianBlur(outImage, inputImage, resolution.x, resolution.y, halfRadius, kernel_2d.data());
+	}
+#endif
+}
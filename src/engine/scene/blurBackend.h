@@ -0,0 +1,56 @@
+#pragma once
+
+#include "gaussianBlur.h"
+
+namespace VK_Renderer
+{
+	enum class BlurBackendType : uint8_t
+	{
+		CPU = 0,	// threaded separable blur, always available
+		CUDA = 1	// needs a build with ENGINE_USE_CUDA
+	};
+
+	// Gaussian blur of RGBA8 images with 1D weights, 2 * halfRadius + 1 of them summing to 1 (GetCachedGaussianKernel1D).
+	// border decides what is read outside the image.
+	class BlurBackend
+	{
+	public:
+		virtual ~BlurBackend() = default;
+
+		virtual BlurBackendType GetType() const = 0;
+
+		virtual void Blur(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						int const& halfRadius, float const* kernel, BlurBorder const& border) = 0;
+
+		static bool IsAvailable(BlurBackendType const& type);
+
+		// Falls back to the CPU backend when the requested one is missing or fails the conformance check
+		static uPtr<BlurBackend> Create(BlurBackendType const& type);
+
+		// Blur a synthetic image with both backends and return the largest channel difference
+		static int Compare(BlurBackend& a, BlurBackend& b, glm::ivec2 const& resolution, int const& halfRadius, float const& sigma);
+
+		// results may differ from the CPU backend by rounding only
+		static constexpr int MaxConformanceError = 1;
+	};
+
+	class CPUBlurBackend : public BlurBackend
+	{
+	public:
+		virtual BlurBackendType GetType() const override { return BlurBackendType::CPU; }
+
+		virtual void Blur(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						int const& halfRadius, float const* kernel, BlurBorder const& border) override;
+	};
+
+#ifdef ENGINE_WITH_CUDA
+	class CUDABlurBackend : public BlurBackend
+	{
+	public:
+		virtual BlurBackendType GetType() const override { return BlurBackendType::CUDA; }
+
+		virtual void Blur(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						int const& halfRadius, float const* kernel, BlurBorder const& border) override;
+	};
+#endif
+}
@@ -0,0 +1,571 @@
+#include "gaussianBlur.h"
+#include "halfFloat.h"
+
+#include "core/threadPool.h"
+
+#include <mutex>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define BLUR_USE_AVX2
+	#define BLUR_USE_SSE
+	#if defined(__F16C__) || defined(_MSC_VER)
+		#define BLUR_USE_F16C
+	#endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BLUR_USE_SSE
+#endif
+
+namespace VK_Renderer
+{
+	// rows of the column pass handled by one task, columns are split in chunks of ColumnTileWidth floats
+	static constexpr int RowTileHeight = 64;
+	static constexpr int ColumnTileWidth = 256;
+
+	std::vector<float> GetGaussianKernel1D(int const& kernelHalfRadius, float const& sigma)
+	{
+		int half_radius = std::max(kernelHalfRadius, 0);
+		std::vector<float> kernel(2 * half_radius + 1);
+		if (sigma <= 0.f)
+		{
+			kernel[half_radius] = 1.f;
+			return kernel;
+		}
+
+		// sum in double from the tails inward, mirrored so both halves hold the same floats
+		double sum = 1.0;
+		kernel[half_radius] = 1.f;
+		for (int x = half_radius; x > 0; --x)
+		{
+			double weight = std::exp(-static_cast<double>(x * x) / (2.0 * sigma * sigma));
+			sum += 2.0 * weight;
+		}
+		for (int x = 0; x <= half_radius; ++x)
+		{
+			double weight = std::exp(-static_cast<double>(x * x) / (2.0 * sigma * sigma));
+			kernel[half_radius - x] = kernel[half_radius + x] = static_cast<float>(weight / sum);
+		}
+		return kernel;
+	}
+
+	std::shared_ptr<std::vector<float> const> GetCachedGaussianKernel1D(int const& kernelHalfRadius, float const& sigma)
+	{
+		static std::mutex cache_mutex;
+		static std::unordered_map<uint64_t, std::shared_ptr<std::vector<float> const>> cache;
+
+		uint32_t sigma_bits;
+		std::memcpy(&sigma_bits, &sigma, sizeof(sigma_bits));
+		uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(kernelHalfRadius)) << 32) | sigma_bits;
+
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto it = cache.find(key);
+		if (it == cache.end())
+		{
+			it = cache.emplace(key, std::make_shared<std::vector<float> const>(GetGaussianKernel1D(kernelHalfRadius, sigma))).first;
+		}
+		return it->second;
+	}
+
+	void DownsampleArea(void* const outImage, glm::ivec2 const& outResolution, void const* const inputImage, glm::ivec2 const& inputResolution)
+	{
+		unsigned char* out = reinterpret_cast<unsigned char*>(outImage);
+		unsigned char const* in = reinterpret_cast<unsigned char const*>(inputImage);
+
+		for (int y = 0; y < outResolution.y; ++y)
+		{
+			int y0 = y * inputResolution.y / outResolution.y;
+			int y1 = std::max((y + 1) * inputResolution.y / outResolution.y, y0 + 1);
+			for (int x = 0; x < outResolution.x; ++x)
+			{
+				int x0 = x * inputResolution.x / outResolution.x;
+				int x1 = std::max((x + 1) * inputResolution.x / outResolution.x, x0 + 1);
+
+				uint32_t sum[4] = { 0, 0, 0, 0 };
+				for (int sy = y0; sy < y1; ++sy)
+				{
+					unsigned char const* row = in + (static_cast<int64_t>(sy) * inputResolution.x + x0) * 4;
+					for (int sx = 0; sx < x1 - x0; ++sx)
+					{
+						for (int c = 0; c < 4; ++c) sum[c] += row[sx * 4 + c];
+					}
+				}
+				uint32_t count = (x1 - x0) * (y1 - y0);
+				for (int c = 0; c < 4; ++c)
+				{
+					out[(static_cast<int64_t>(y) * outResolution.x + x) * 4 + c] = static_cast<unsigned char>((sum[c] + count / 2) / count);
+				}
+			}
+		}
+	}
+
+	void DownsampleAreaHalf(void* const outImage, glm::ivec2 const& outResolution, void const* const inputImage, glm::ivec2 const& inputResolution)
+	{
+		uint16_t* out = reinterpret_cast<uint16_t*>(outImage);
+		uint16_t const* in = reinterpret_cast<uint16_t const*>(inputImage);
+
+		for (int y = 0; y < outResolution.y; ++y)
+		{
+			int y0 = y * inputResolution.y / outResolution.y;
+			int y1 = std::max((y + 1) * inputResolution.y / outResolution.y, y0 + 1);
+			for (int x = 0; x < outResolution.x; ++x)
+			{
+				int x0 = x * inputResolution.x / outResolution.x;
+				int x1 = std::max((x + 1) * inputResolution.x / outResolution.x, x0 + 1);
+
+				float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+				for (int sy = y0; sy < y1; ++sy)
+				{
+					uint16_t const* row = in + (static_cast<int64_t>(sy) * inputResolution.x + x0) * 4;
+					for (int sx = 0; sx < x1 - x0; ++sx)
+					{
+						for (int c = 0; c < 4; ++c) sum[c] += HalfToFloat(row[sx * 4 + c]);
+					}
+				}
+				float inv_count = 1.f / static_cast<float>((x1 - x0) * (y1 - y0));
+				for (int c = 0; c < 4; ++c)
+				{
+					out[(static_cast<int64_t>(y) * outResolution.x + x) * 4 + c] = FloatToHalf(sum[c] * inv_count);
+				}
+			}
+		}
+	}
+
+	struct Pixel
+	{
+		unsigned char r;
+		unsigned char g;
+		unsigned char b;
+		unsigned char a;
+	};
+
+	int GetBorderIndex(int const& index, int const& size, BlurBorder const& border)
+	{
+		if (index >= 0 && index < size) return index;
+		switch (border)
+		{
+		case BlurBorder::Mirror:
+		{
+			// edge texel repeated, like GL_MIRRORED_REPEAT
+			int period = 2 * size;
+			int m = ((index % period) + period) % period;
+			return (m < size ? m : period - 1 - m);
+		}
+		case BlurBorder::Clamp:
+			return std::clamp(index, 0, size - 1);
+		default:
+			return -1;
+		}
+	}
+
+	void GaussianBlur2D(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						int const& kernelHalfRadius, float const* kernel, BlurBorder const& border)
+	{
+		Pixel* out_image = reinterpret_cast<Pixel*>(outImage);
+		Pixel const* input_image = reinterpret_cast<Pixel const*>(inputImage);
+		int kernel_radius = ((kernelHalfRadius << 1) + 1);
+
+		for (int y = 0; y < resolution.y; ++y) {
+			for (int x = 0; x < resolution.x; ++x) {
+				float totalRed = 0, totalGreen = 0, totalBlue = 0, totalAlpha = 0, totalWeight = 0;
+				for (int ky = -kernelHalfRadius; ky <= kernelHalfRadius; ky++) {
+					for (int kx = -kernelHalfRadius; kx <= kernelHalfRadius; kx++) {
+						int pixelPosX = GetBorderIndex(x + kx, resolution.x, border);
+						int pixelPosY = GetBorderIndex(y + ky, resolution.y, border);
+
+						// Boundary check
+						if (pixelPosX >= 0 && pixelPosX < resolution.x && pixelPosY >= 0 && pixelPosY < resolution.y) {
+							Pixel const& pixel = input_image[pixelPosY * resolution.x + pixelPosX];
+							float weight = kernel[(ky + kernelHalfRadius) * kernel_radius + kx + kernelHalfRadius];
+
+							totalRed += pixel.r * weight;
+							totalGreen += pixel.g * weight;
+							totalBlue += pixel.b * weight;
+							totalAlpha += pixel.a * weight;
+							totalWeight += weight;
+						}
+					}
+				}
+
+				Pixel& newPixel = out_image[y * resolution.x + x];
+				newPixel.r = static_cast<unsigned char>(totalRed / totalWeight + 0.5f);
+				newPixel.g = static_cast<unsigned char>(totalGreen / totalWeight + 0.5f);
+				newPixel.b = static_cast<unsigned char>(totalBlue / totalWeight + 0.5f);
+				newPixel.a = static_cast<unsigned char>(totalAlpha / totalWeight + 0.5f);
+			}
+		}
+	}
+
+	// Sum of the kernel weights that land inside [0, size) around position
+	inline float KernelWeight(std::vector<float> const& prefixSum, int const& position, int const& size, int const& halfRadius)
+	{
+		int lo = std::max(halfRadius - position, 0);
+		int hi = std::min(size - 1 - position + halfRadius, 2 * halfRadius);
+		return prefixSum[hi + 1] - prefixSum[lo];
+	}
+
+	// Pixels [begin, end) of a row whose taps all lie inside in, out and in hold 4 floats per pixel.
+	// The kernel sums to 1, so there is no bound check and no renormalization.
+	static void BlurRowInterior(float* const out, float const* const in, int const& begin, int const& end,
+								int const& halfRadius, float const* kernel)
+	{
+		int kernel_size = 2 * halfRadius + 1;
+		int x = begin;
+#if defined(BLUR_USE_AVX2)
+		// two pixels per register
+		for (; x + 1 < end; x += 2)
+		{
+			float const* p = in + (x - halfRadius) * 4;
+			__m256 sum = _mm256_setzero_ps();
+			for (int j = 0; j < kernel_size; ++j)
+			{
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel[j]), _mm256_loadu_ps(p + j * 4)));
+			}
+			_mm256_storeu_ps(out + x * 4, sum);
+		}
+#endif
+#if defined(BLUR_USE_SSE)
+		for (; x < end; ++x)
+		{
+			float const* p = in + (x - halfRadius) * 4;
+			__m128 sum = _mm_setzero_ps();
+			for (int j = 0; j < kernel_size; ++j)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel[j]), _mm_loadu_ps(p + j * 4)));
+			}
+			_mm_storeu_ps(out + x * 4, sum);
+		}
+#else
+		for (; x < end; ++x)
+		{
+			float const* p = in + (x - halfRadius) * 4;
+			float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+			for (int j = 0; j < kernel_size; ++j)
+			{
+				for (int c = 0; c < 4; ++c) sum[c] += kernel[j] * p[j * 4 + c];
+			}
+			for (int c = 0; c < 4; ++c) out[x * 4 + c] = sum[c];
+		}
+#endif
+	}
+
+	// out and in hold 4 floats per pixel, taps outside the row are dropped and the rest renormalized
+	static void BlurRow(float* const out, float const* const in, int const& width, int const& halfRadius,
+						float const* kernel, std::vector<float> const& prefixSum)
+	{
+		int kernel_size = 2 * halfRadius + 1;
+		int interior_begin = std::min(halfRadius, width);
+		int interior_end = std::max(width - halfRadius, interior_begin);
+
+		// borders, only the taps inside the row
+		auto blur_border = [&](int const& x) {
+			int lo = std::max(halfRadius - x, 0);
+			int hi = std::min(width - 1 - x + halfRadius, kernel_size - 1);
+			float inv_weight = 1.f / KernelWeight(prefixSum, x, width, halfRadius);
+			float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+			for (int j = lo; j <= hi; ++j)
+			{
+				float const* p = in + (x - halfRadius + j) * 4;
+				for (int c = 0; c < 4; ++c) sum[c] += kernel[j] * p[c];
+			}
+			for (int c = 0; c < 4; ++c) out[x * 4 + c] = sum[c] * inv_weight;
+		};
+
+		for (int x = 0; x < interior_begin; ++x) blur_border(x);
+
+		BlurRowInterior(out, in, interior_begin, interior_end, halfRadius, kernel);
+
+		for (int x = interior_end; x < width; ++x) blur_border(x);
+	}
+
+	// Column pass over floats [columnBegin, columnEnd) of row y, in has a stride of rowStride floats.
+	// A padded in holds halfRadius extra rows above and below the image so no window is clipped.
+	template<typename Texel>
+	static void BlurColumns(Texel* const out, float const* const in, int const& y, int const& height, int const& rowStride,
+							int const& columnBegin, int const& columnEnd, int const& halfRadius,
+							float const* kernel, std::vector<float> const& prefixSum, bool const& padded)
+	{
+		int lo = (padded ? 0 : std::max(halfRadius - y, 0));
+		int hi = (padded ? 2 * halfRadius : std::min(height - 1 - y + halfRadius, 2 * halfRadius));
+		// rows whose window is clipped renormalize by the weights left, the others already sum to 1
+		float inv_weight = (hi - lo == 2 * halfRadius) ? 1.f : 1.f / KernelWeight(prefixSum, y, height, halfRadius);
+		// rows[0] is the first row read, weight kernel[lo]
+		float const* rows = in + static_cast<int64_t>(padded ? y : y - halfRadius + lo) * rowStride;
+		kernel += lo;
+		hi -= lo;
+		lo = 0;
+
+		int c = columnBegin;
+#if defined(BLUR_USE_AVX2)
+		__m256 inv_weight_8 = _mm256_set1_ps(inv_weight);
+		__m256 half_8 = _mm256_set1_ps(0.5f);
+		for (; c + 8 <= columnEnd; c += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (int j = lo; j <= hi; ++j)
+			{
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel[j]), _mm256_loadu_ps(rows + static_cast<int64_t>(j) * rowStride + c)));
+			}
+			if constexpr (std::is_same_v<Texel, uint16_t>)
+			{
+#if defined(BLUR_USE_F16C)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + c), _mm256_cvtps_ph(_mm256_mul_ps(sum, inv_weight_8), _MM_FROUND_TO_NEAREST_INT));
+#else
+				alignas(32) float value[8];
+				_mm256_store_ps(value, _mm256_mul_ps(sum, inv_weight_8));
+				for (int i = 0; i < 8; ++i) out[c + i] = FloatToHalf(value[i]);
+#endif
+			}
+			else
+			{
+				// round like the 2D blur, then pack 8 ints to 8 bytes
+				__m256i value = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(sum, inv_weight_8), half_8));
+				__m128i value_16 = _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + c), _mm_packus_epi16(value_16, value_16));
+			}
+		}
+#endif
+#if defined(BLUR_USE_SSE)
+		__m128 inv_weight_4 = _mm_set1_ps(inv_weight);
+		__m128 half_4 = _mm_set1_ps(0.5f);
+		for (; c + 4 <= columnEnd; c += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (int j = lo; j <= hi; ++j)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel[j]), _mm_loadu_ps(rows + static_cast<int64_t>(j) * rowStride + c)));
+			}
+			if constexpr (std::is_same_v<Texel, uint16_t>)
+			{
+				alignas(16) float value[4];
+				_mm_store_ps(value, _mm_mul_ps(sum, inv_weight_4));
+				for (int i = 0; i < 4; ++i) out[c + i] = FloatToHalf(value[i]);
+			}
+			else
+			{
+				__m128i value = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum, inv_weight_4), half_4));
+				__m128i value_16 = _mm_packs_epi32(value, value);
+				int packed = _mm_cvtsi128_si32(_mm_packus_epi16(value_16, value_16));
+				std::memcpy(out + c, &packed, 4);
+			}
+		}
+#endif
+		for (; c < columnEnd; ++c)
+		{
+			float sum = 0.f;
+			for (int j = lo; j <= hi; ++j)
+			{
+				sum += kernel[j] * rows[static_cast<int64_t>(j) * rowStride + c];
+			}
+			if constexpr (std::is_same_v<Texel, uint16_t>)
+			{
+				out[c] = FloatToHalf(sum * inv_weight);
+			}
+			else
+			{
+				out[c] = static_cast<unsigned char>(sum * inv_weight + 0.5f);
+			}
+		}
+	}
+
+	inline float TexelToFloat(unsigned char const& value) { return value; }
+	inline float TexelToFloat(uint16_t const& value) { return HalfToFloat(value); }
+
+	// Shared by the 8 bit and half float blurs, only loading rows and storing the column pass differ
+	template<typename Texel>
+	static void BlurSeparable(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+								int const& kernelHalfRadius, float const* kernel, MyCore::ThreadPool& pool, BlurBorder const& border)
+	{
+		int width = resolution.x;
+		int height = resolution.y;
+		if (width <= 0 || height <= 0) return;
+
+		int row_stride = width * 4;
+		int kernel_size = 2 * kernelHalfRadius + 1;
+		std::vector<float> prefix_sum(kernel_size + 1, 0.f);
+		for (int j = 0; j < kernel_size; ++j)
+		{
+			prefix_sum[j + 1] = prefix_sum[j] + kernel[j];
+		}
+
+		Texel const* input = reinterpret_cast<Texel const*>(inputImage);
+		Texel* output = reinterpret_cast<Texel*>(outImage);
+
+		// clamp and mirror pad rows and columns up front so every pixel takes the interior path
+		bool padded = (border != BlurBorder::Renormalize);
+		int pad = (padded ? kernelHalfRadius : 0);
+
+		// row pass keeps floats so only the final result is rounded, as in the 2D blur
+		std::vector<float> horizontal(static_cast<size_t>(row_stride) * (height + 2 * pad));
+		float* horizontal_rows = horizontal.data() + static_cast<int64_t>(pad) * row_stride;
+		pool.ParallelFor(0, height, [&](uint32_t y) {
+			std::vector<float> row((width + 2 * pad) * 4);
+			Texel const* src = input + static_cast<int64_t>(y) * row_stride;
+			int i = 0;
+#if defined(BLUR_USE_F16C)
+			if constexpr (std::is_same_v<Texel, uint16_t>)
+			{
+				for (; i + 8 <= row_stride; i += 8)
+				{
+					_mm256_storeu_ps(row.data() + pad * 4 + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i))));
+				}
+			}
+#endif
+			for (; i < row_stride; ++i) row[pad * 4 + i] = TexelToFloat(src[i]);
+			for (int x = 0; x < pad; ++x)
+			{
+				Texel const* left = src + GetBorderIndex(x - pad, width, border) * 4;
+				Texel const* right = src + GetBorderIndex(width + x, width, border) * 4;
+				for (int c = 0; c < 4; ++c)
+				{
+					row[x * 4 + c] = TexelToFloat(left[c]);
+					row[(pad + width + x) * 4 + c] = TexelToFloat(right[c]);
+				}
+			}
+			float* dst = horizontal_rows + static_cast<int64_t>(y) * row_stride;
+			if (padded)
+			{
+				BlurRowInterior(dst, row.data() + pad * 4, 0, width, kernelHalfRadius, kernel);
+			}
+			else
+			{
+				BlurRow(dst, row.data(), width, kernelHalfRadius, kernel, prefix_sum);
+			}
+		});
+		for (int y = -pad; y < 0; ++y)
+		{
+			std::memcpy(horizontal_rows + static_cast<int64_t>(y) * row_stride,
+						horizontal_rows + static_cast<int64_t>(GetBorderIndex(y, height, border)) * row_stride, row_stride * sizeof(float));
+		}
+		for (int y = height; y < height + pad; ++y)
+		{
+			std::memcpy(horizontal_rows + static_cast<int64_t>(y) * row_stride,
+						horizontal_rows + static_cast<int64_t>(GetBorderIndex(y, height, border)) * row_stride, row_stride * sizeof(float));
+		}
+
+		// column pass in tiles so the rows a tile reads stay in cache
+		int tile_rows = (height + RowTileHeight - 1) / RowTileHeight;
+		int tile_columns = (row_stride + ColumnTileWidth - 1) / ColumnTileWidth;
+		pool.ParallelFor(0, tile_rows * tile_columns, [&](uint32_t tile) {
+			int row_begin = (tile / tile_columns) * RowTileHeight;
+			int row_end = std::min(row_begin + RowTileHeight, height);
+			int column_begin = (tile % tile_columns) * ColumnTileWidth;
+			int column_end = std::min(column_begin + ColumnTileWidth, row_stride);
+			for (int y = row_begin; y < row_end; ++y)
+			{
+				BlurColumns(output + static_cast<int64_t>(y) * row_stride, horizontal.data(), y, height, row_stride,
+							column_begin, column_end, kernelHalfRadius, kernel, prefix_sum, padded);
+			}
+		});
+	}
+
+	void GaussianBlurSeparable(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+								int const& kernelHalfRadius, float const* kernel, MyCore::ThreadPool& pool, BlurBorder const& border)
+	{
+		BlurSeparable<unsigned char>(outImage, inputImage, resolution, kernelHalfRadius, kernel, pool, border);
+	}
+
+	void GaussianBlurSeparableHalf(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+									int const& kernelHalfRadius, float const* kernel, MyCore::ThreadPool& pool, BlurBorder const& border)
+	{
+		BlurSeparable<uint16_t>(outImage, inputImage, resolution, kernelHalfRadius, kernel, pool, border);
+	}
+
+	std::array<int, 3> GetBoxCascadeRadii(float const& sigma)
+	{
+		// widths wl and wl + 2 (both odd) mixed so the summed variance (w^2 - 1) / 12 matches sigma^2
+		int const n = 3;
+		float ideal_width = std::sqrt(12.f * sigma * sigma / n + 1.f);
+		int wl = static_cast<int>(std::floor(ideal_width));
+		if (wl % 2 == 0) --wl;
+		wl = std::max(wl, 1);
+		int wu = wl + 2;
+		float ideal_count = (12.f * sigma * sigma - n * wl * wl - 4.f * n * wl - 3.f * n) / (-4.f * wl - 4.f);
+		int count = std::clamp(static_cast<int>(std::round(ideal_count)), 0, n);
+
+		std::array<int, 3> radii;
+		for (int i = 0; i < n; ++i)
+		{
+			radii[i] = ((i < count ? wl : wu) - 1) / 2;
+		}
+		return radii;
+	}
+
+	// Box filter of radius over count pixels of 4 floats, stride in floats between pixels
+	static void BoxLine(float* const out, float const* const in, int const& count, int const& stride, int const& radius)
+	{
+		float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+		for (int j = 0; j <= std::min(radius, count - 1); ++j)
+		{
+			for (int c = 0; c < 4; ++c) sum[c] += in[j * stride + c];
+		}
+
+		for (int x = 0; x < count; ++x)
+		{
+			int lo = std::max(x - radius, 0);
+			int hi = std::min(x + radius, count - 1);
+			float inv_count = 1.f / static_cast<float>(hi - lo + 1);
+			for (int c = 0; c < 4; ++c) out[x * stride + c] = sum[c] * inv_count;
+
+			// slide the window
+			if (x + radius + 1 < count)
+			{
+				for (int c = 0; c < 4; ++c) sum[c] += in[(x + radius + 1) * stride + c];
+			}
+			if (x - radius >= 0)
+			{
+				for (int c = 0; c < 4; ++c) sum[c] -= in[(x - radius) * stride + c];
+			}
+		}
+	}
+
+	void BoxBlurCascade(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						float const& sigma, MyCore::ThreadPool& pool)
+	{
+		int width = resolution.x;
+		int height = resolution.y;
+		if (width <= 0 || height <= 0) return;
+
+		int row_stride = width * 4;
+		std::array<int, 3> radii = GetBoxCascadeRadii(sigma);
+		unsigned char const* input = reinterpret_cast<unsigned char const*>(inputImage);
+		unsigned char* output = reinterpret_cast<unsigned char*>(outImage);
+
+		// rows, three boxes ping-ponging between two row buffers
+		std::vector<float> horizontal(static_cast<size_t>(row_stride) * height);
+		pool.ParallelFor(0, height, [&](uint32_t y) {
+			std::vector<float> a(row_stride), b(row_stride);
+			unsigned char const* src = input + static_cast<int64_t>(y) * row_stride;
+			for (int i = 0; i < row_stride; ++i) a[i] = src[i];
+			BoxLine(b.data(), a.data(), width, 4, radii[0]);
+			BoxLine(a.data(), b.data(), width, 4, radii[1]);
+			BoxLine(horizontal.data() + static_cast<int64_t>(y) * row_stride, a.data(), width, 4, radii[2]);
+		});
+
+		// columns, a group of pixels is gathered so the three passes stay in cache
+		int const group_width = ColumnTileWidth / 4;
+		int group_count = (width + group_width - 1) / group_width;
+		pool.ParallelFor(0, group_count, [&](uint32_t group) {
+			int x_begin = group * group_width;
+			int x_count = std::min(group_width, width - x_begin);
+			int stride = x_count * 4;
+			std::vector<float> a(static_cast<size_t>(stride) * height), b(a.size());
+			for (int y = 0; y < height; ++y)
+			{
+				std::memcpy(a.data() + static_cast<int64_t>(y) * stride, horizontal.data() + static_cast<int64_t>(y) * row_stride + x_begin * 4, stride * sizeof(float));
+			}
+			for (int x = 0; x < x_count; ++x)
+			{
+				BoxLine(b.data() + x * 4, a.data() + x * 4, height, stride, radii[0]);
+				BoxLine(a.data() + x * 4, b.data() + x * 4, height, stride, radii[1]);
+				BoxLine(b.data() + x * 4, a.data() + x * 4, height, stride, radii[2]);
+			}
+			for (int y = 0; y < height; ++y)
+			{
+				unsigned char* dst = output + static_cast<int64_t>(y) * row_stride + x_begin * 4;
+				float const* src = b.data() + static_cast<int64_t>(y) * stride;
+				for (int i = 0; i < stride; ++i) dst[i] = static_cast<unsigned char>(std::min(src[i] + 0.5f, 255.f));
+			}
+		});
+	}
+}
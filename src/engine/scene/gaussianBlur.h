@@ -0,0 +1,57 @@
+#pragma once
+
+namespace MyCore
+{
+	class ThreadPool;
+}
+
+namespace VK_Renderer
+{
+	// What the blur sees outside the image
+	enum class BlurBorder : uint8_t
+	{
+		Renormalize = 0,	// taps outside are dropped and the rest renormalized, light blocks never bleed
+		Clamp = 1,			// edge texel repeated
+		Mirror = 2			// image mirrored at the edge, the edge texel included
+	};
+
+	// Texel read for index in [0, size) under border, -1 when Renormalize drops it
+	int GetBorderIndex(int const& index, int const& size, BlurBorder const& border);
+
+	// 1D weights exp(-x^2 / (2 sigma^2)) for x in [-kernelHalfRadius, kernelHalfRadius], normalized to sum to 1
+	// and exactly symmetric. The separable blur relies on the normalization to skip the divide in the interior.
+	std::vector<float> GetGaussianKernel1D(int const& kernelHalfRadius, float const& sigma);
+
+	// Same weights as GetGaussianKernel1D, built once per (kernelHalfRadius, sigma) and shared by every blur backend
+	std::shared_ptr<std::vector<float> const> GetCachedGaussianKernel1D(int const& kernelHalfRadius, float const& sigma);
+
+	// Area average of an RGBA8 image to a smaller resolution, each output texel averages the input texels it covers
+	void DownsampleArea(void* const outImage, glm::ivec2 const& outResolution, void const* const inputImage, glm::ivec2 const& inputResolution);
+	// Same for RGBA16F, averaged in float
+	void DownsampleAreaHalf(void* const outImage, glm::ivec2 const& outResolution, void const* const inputImage, glm::ivec2 const& inputResolution);
+
+	// Full 2D convolution of an RGBA8 image, kept as the reference for the separable blur.
+	// kernel holds (2 * kernelHalfRadius + 1)^2 weights, outside the image border decides what is read.
+	void GaussianBlur2D(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						int const& kernelHalfRadius, float const* kernel, BlurBorder const& border = BlurBorder::Renormalize);
+
+	// Radii of three box filters whose cascade has the variance of a Gaussian of sigma
+	std::array<int, 3> GetBoxCascadeRadii(float const& sigma);
+
+	// Gaussian approximated by three box filters per axis with running sums, the cost per pixel does not
+	// depend on sigma. Windows are clipped at the border and renormalized like the Gaussian blur.
+	void BoxBlurCascade(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+						float const& sigma, MyCore::ThreadPool& pool);
+
+	// Same result as GaussianBlur2D (within 1 LSB) with a row pass and a column pass of the 1D kernel.
+	// Rows and column tiles are spread over the pool, the inner loops use AVX2 or SSE when built with them.
+	// Clamp and Mirror pad the rows and columns first, so the whole image runs without bound checks.
+	void GaussianBlurSeparable(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+								int const& kernelHalfRadius, float const* kernel, MyCore::ThreadPool& pool,
+								BlurBorder const& border = BlurBorder::Renormalize);
+
+	// GaussianBlurSeparable for RGBA16F images, blurred in linear float and stored without rounding to 8 bits
+	void GaussianBlurSeparableHalf(void* const outImage, void const* const inputImage, glm::ivec2 const& resolution,
+									int const& kernelHalfRadius, float const* kernel, MyCore::ThreadPool& pool,
+									BlurBorder const& border = BlurBorder::Renormalize);
+}
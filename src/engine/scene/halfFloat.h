@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace VK_Renderer
+{
+	// IEEE binary16 stored in a uint16_t, as in RGBA16F textures. Rounds to nearest even,
+	// values past the half range become infinity.
+	inline uint16_t FloatToHalf(float const& value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000u;
+		uint32_t magnitude = bits & 0x7fffffffu;
+
+		if (magnitude >= 0x7f800000u) return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+		if (magnitude >= 0x477ff000u) return static_cast<uint16_t>(sign | 0x7c00u); // rounds past 65504
+		if (magnitude < 0x38800000u)
+		{
+			// half subnormal, its unit is 2^-24
+			if (magnitude < 0x33000000u) return static_cast<uint16_t>(sign);
+			uint32_t shift = 126u - (magnitude >> 23);
+			uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+			uint32_t half = mantissa >> shift;
+			uint32_t rest = mantissa & ((1u << shift) - 1u);
+			uint32_t halfway = 1u << (shift - 1u);
+			if (rest > halfway || (rest == halfway && (half & 1u))) ++half;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		// rebias the exponent from 127 to 15 and drop 13 mantissa bits, a carry moves into the exponent
+		uint32_t half = (magnitude - 0x38000000u) >> 13;
+		uint32_t rest = magnitude & 0x1fffu;
+		if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	inline float HalfToFloat(uint16_t const& value)
+	{
+		uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+		uint32_t exponent = (value >> 10) & 0x1fu;
+		uint32_t mantissa = value & 0x3ffu;
+
+		uint32_t bits;
+		if (exponent == 0)
+		{
+			float subnormal = static_cast<float>(mantissa) * (1.f / 16777216.f);
+			return (sign ? -subnormal : subnormal);
+		}
+		else if (exponent == 31)
+		{
+			bits = sign | 0x7f800000u | (mantissa << 13);
+		}
+		else
+		{
+			bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+		}
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+}
@@ -1,32 +1,200 @@
 #include "image.h"
+#include "pixelBufferPool.h"
+#include "halfFloat.h"
 
+// decode straight into pooled buffers, the copies of stb reallocations show up in the pool stats
+#define STBI_MALLOC(size) VK_Renderer::PixelBufferPool::GetInstance().Allocate(size)
+#define STBI_REALLOC(buffer, size) VK_Renderer::PixelBufferPool::GetInstance().Reallocate(buffer, size)
+#define STBI_FREE(buffer) VK_Renderer::PixelBufferPool::GetInstance().Free(buffer)
 #include <stb_image.h>
 
-#include <dds.h>
 #include <iostream>
 namespace VK_Renderer
 {
+    // dds header as read from the file: magic, DDS_HEADER and the optional DDS_HEADER_DXT10
+    struct DDSHeader
+    {
+        uint32_t data[37];
+
+        uint32_t Height() const { return data[3]; }
+        uint32_t Width() const { return data[4]; }
+        uint32_t Depth() const { return data[6]; }
+        uint32_t MipCount() const { return (data[2] & 0x20000) ? std::max(data[7], 1u) : 1u; } // DDSD_MIPMAPCOUNT
+        uint32_t PixelFlags() const { return data[20]; }
+        uint32_t FourCC() const { return data[21]; }
+        uint32_t BitCount() const { return data[22]; }
+        uint32_t RedMask() const { return data[23]; }
+        uint32_t Caps2() const { return data[28]; }
+        bool HasDX10() const { return FourCC() == 0x30315844; } // "DX10"
+        uint32_t DXGIFormat() const { return data[32]; }
+        uint32_t MiscFlag() const { return data[34]; }
+        uint32_t ArraySize() const { return std::max(data[35], 1u); }
+        uint64_t Size() const { return (HasDX10() ? 37 : 32) * sizeof(uint32_t); }
+    };
+
+    struct DDSFormat
+    {
+        vk::Format format{ vk::Format::eUndefined };
+        uint32_t blockBytes{ 0 }; // bytes per texel, or per 4x4 block for compressed formats
+        uint32_t blockSize{ 1 };
+    };
+
+    static DDSFormat GetDXGIFormat(uint32_t const& dxgi)
+    {
+        switch (dxgi)
+        {
+        case 2:  return { vk::Format::eR32G32B32A32Sfloat, 16 };
+        case 6:  return { vk::Format::eR32G32B32Sfloat, 12 };
+        case 10: return { vk::Format::eR16G16B16A16Sfloat, 8 };
+        case 11: return { vk::Format::eR16G16B16A16Unorm, 8 };
+        case 16: return { vk::Format::eR32G32Sfloat, 8 };
+        case 28: return { vk::Format::eR8G8B8A8Unorm, 4 };
+        case 29: return { vk::Format::eR8G8B8A8Srgb, 4 };
+        case 34: return { vk::Format::eR16G16Sfloat, 4 };
+        case 41: return { vk::Format::eR32Sfloat, 4 };
+        case 49: return { vk::Format::eR8G8Unorm, 2 };
+        case 54: return { vk::Format::eR16Sfloat, 2 };
+        case 61: return { vk::Format::eR8Unorm, 1 };
+        case 71: return { vk::Format::eBc1RgbaUnormBlock, 8, 4 };
+        case 72: return { vk::Format::eBc1RgbaSrgbBlock, 8, 4 };
+        case 74: return { vk::Format::eBc2UnormBlock, 16, 4 };
+        case 75: return { vk::Format::eBc2SrgbBlock, 16, 4 };
+        case 77: return { vk::Format::eBc3UnormBlock, 16, 4 };
+        case 78: return { vk::Format::eBc3SrgbBlock, 16, 4 };
+        case 80: return { vk::Format::eBc4UnormBlock, 8, 4 };
+        case 83: return { vk::Format::eBc5UnormBlock, 16, 4 };
+        case 87: return { vk::Format::eB8G8R8A8Unorm, 4 };
+        case 91: return { vk::Format::eB8G8R8A8Srgb, 4 };
+        case 95: return { vk::Format::eBc6HUfloatBlock, 16, 4 };
+        case 96: return { vk::Format::eBc6HSfloatBlock, 16, 4 };
+        case 98: return { vk::Format::eBc7UnormBlock, 16, 4 };
+        case 99: return { vk::Format::eBc7SrgbBlock, 16, 4 };
+        default: return {};
+        }
+    }
+
+    static DDSFormat GetDDSFormat(DDSHeader const& header)
+    {
+        if (header.HasDX10()) return GetDXGIFormat(header.DXGIFormat());
+
+        if (header.PixelFlags() & 0x4) // DDPF_FOURCC
+        {
+            switch (header.FourCC())
+            {
+            case 0x31545844: return { vk::Format::eBc1RgbaUnormBlock, 8, 4 };  // "DXT1"
+            case 0x33545844: return { vk::Format::eBc2UnormBlock, 16, 4 };     // "DXT3"
+            case 0x35545844: return { vk::Format::eBc3UnormBlock, 16, 4 };     // "DXT5"
+            case 0x31495441: return { vk::Format::eBc4UnormBlock, 8, 4 };      // "ATI1"
+            case 0x32495441: return { vk::Format::eBc5UnormBlock, 16, 4 };     // "ATI2"
+            // D3DFORMAT values stored in the four cc
+            case 36:  return { vk::Format::eR16G16B16A16Unorm, 8 };
+            case 111: return { vk::Format::eR16Sfloat, 2 };
+            case 112: return { vk::Format::eR16G16Sfloat, 4 };
+            case 113: return { vk::Format::eR16G16B16A16Sfloat, 8 };
+            case 114: return { vk::Format::eR32Sfloat, 4 };
+            case 115: return { vk::Format::eR32G32Sfloat, 8 };
+            case 116: return { vk::Format::eR32G32B32A32Sfloat, 16 };
+            default: return {};
+            }
+        }
+
+        if (header.BitCount() == 32)
+        {
+            return { header.RedMask() == 0xff ? vk::Format::eR8G8B8A8Unorm : vk::Format::eB8G8R8A8Unorm, 4 };
+        }
+        if (header.BitCount() == 8) return { vk::Format::eR8Unorm, 1 };
+        return {};
+    }
+
+    static bool ReadDDSHeader(std::ifstream& in, uint64_t const& fileSize, DDSHeader& header)
+    {
+        uint64_t const base_size = 32 * sizeof(uint32_t);
+        if (fileSize < base_size || !in.read(reinterpret_cast<char*>(header.data), base_size)) return false;
+        if (header.data[0] != 0x20534444) return false; // "DDS "
+
+        if (header.HasDX10())
+        {
+            if (fileSize < header.Size() || !in.read(reinterpret_cast<char*>(header.data + 32), header.Size() - base_size)) return false;
+        }
+        return true;
+    }
+
+    PixelView::PixelView(Image const& image)
+        : data(image.GetRawData()), size(image.GetSize()), resolution(image.GetResolution()), format(image.GetFormat())
+    {
+    }
+
+    Image::Image()
+        : m_Resolution(0), m_Format(vk::Format::eUndefined), m_MipCount(1), m_LayerCount(1)
+    {
+    }
+
     Image::Image(std::string const& file)
+        : Image()
     {
         LoadFromFile(file);
     }
-    Image::Image(void* data,
-                uint32_t const& size,
-                glm::ivec3 const& resolution)
-        : m_RawData(data), m_Size(size), m_Resolution(resolution)
+
+    Image::Image(glm::ivec3 const& resolution, uint32_t const& size)
+        : m_RawData(PixelBufferPool::GetInstance().Allocate(size)), m_Size(size), m_Resolution(resolution), 
+          m_Format(vk::Format::eUndefined), m_MipCount(1), m_LayerCount(1),
+          m_Subresources{ ImageSubresource{ .extent = { resolution.x, resolution.y }, .size = size } }
     {
     }
-    Image::Image(const Image& img)
-        :m_Size(img.m_Size), m_Resolution(img.GetResolution())
+
+    Image::Image(std::vector<ImageSubresource> const& subresources, vk::Format const& format)
+        : Image()
     {
-        m_RawData = malloc(m_Size);
-        if(img.GetRawData()!=nullptr)std::memcpy(m_RawData, img.GetRawData(), m_Size);
+        if (subresources.size() == 0) return;
+
+        uint64_t size = 0;
+        for (ImageSubresource const& subresource : subresources)
+        {
+            size = std::max(size, subresource.offset + subresource.size);
+            m_MipCount = std::max(m_MipCount, subresource.mipLevel + 1);
+            m_LayerCount = std::max(m_LayerCount, subresource.arrayLayer + 1);
+        }
+        m_Size = static_cast<uint32_t>(size);
+        m_RawData = PixelBufferPool::GetInstance().Allocate(m_Size);
+        m_Resolution = { subresources[0].extent.x, subresources[0].extent.y, 1 };
+        m_Format = format;
+        m_Subresources = subresources;
     }
 
-    Image::Image(Image&& img)
-        :m_Size(img.m_Size),m_Resolution(img.m_Resolution),m_RawData(img.m_RawData)
+    Image::Image(Image&& img) noexcept
+        :m_RawData(img.m_RawData), m_Size(img.m_Size), m_Resolution(img.m_Resolution),
+         m_Format(img.m_Format), m_MipCount(img.m_MipCount), m_LayerCount(img.m_LayerCount),
+         m_Subresources(std::move(img.m_Subresources))
     {
         img.m_RawData = nullptr;
+        img.Free();
+    }
+
+    Image& Image::operator=(Image&& img) noexcept
+    {
+        if (this != &img)
+        {
+            Free();
+            std::swap(m_RawData, img.m_RawData);
+            std::swap(m_Size, img.m_Size);
+            std::swap(m_Resolution, img.m_Resolution);
+            std::swap(m_Format, img.m_Format);
+            std::swap(m_MipCount, img.m_MipCount);
+            std::swap(m_LayerCount, img.m_LayerCount);
+            std::swap(m_Subresources, img.m_Subresources);
+        }
+        return *this;
+    }
+
+    Image Image::Clone() const
+    {
+        Image image(m_Resolution, m_Size);
+        if (m_RawData) PixelBufferPool::GetInstance().Copy(image.m_RawData, m_RawData, m_Size);
+        image.m_Format = m_Format;
+        image.m_MipCount = m_MipCount;
+        image.m_LayerCount = m_LayerCount;
+        image.m_Subresources = m_Subresources;
+        return image;
     }
 
     Image::~Image()
@@ -36,10 +204,39 @@ namespace VK_Renderer
 
     void Image::Free()
     {
-        if (m_RawData) free(m_RawData);
+        PixelBufferPool::GetInstance().Free(m_RawData);
         m_RawData = nullptr;
         m_Size = 0;
         m_Resolution = {};
+        m_Format = vk::Format::eUndefined;
+        m_MipCount = 1;
+        m_LayerCount = 1;
+        m_Subresources.clear();
+    }
+
+    bool Image::ReadInfo(std::string const& file, ImageInfo& info)
+    {
+        size_t postfix_start = file.find_last_of(".");
+        std::string file_postfix = file.substr(postfix_start + 1, file.size() - postfix_start);
+        if (file_postfix == "dds") {
+            std::ifstream in(file, std::ios::ate | std::ios::binary);
+            if (!in.is_open()) return false;
+            uint64_t file_size = in.tellg();
+            in.seekg(0);
+
+            DDSHeader header;
+            if (!ReadDDSHeader(in, file_size, header)) return false;
+
+            info.resolution = { static_cast<int>(header.Width()), static_cast<int>(header.Height()), 1 };
+            info.size = file_size - header.Size();
+            info.format = GetDDSFormat(header).format;
+            return info.format != vk::Format::eUndefined;
+        }
+
+        if (stbi_info(file.c_str(), &info.resolution.x, &info.resolution.y, &info.resolution.z) == 0) return false;
+        // decoded as STBI_rgb_alpha
+        info.size = static_cast<uint64_t>(info.resolution.x) * info.resolution.y * 4 * sizeof(unsigned char);
+        return true;
     }
 
 	void Image::LoadFromFile(std::string const& file)
@@ -50,24 +247,116 @@ namespace VK_Renderer
 		std::string file_postfix = file.substr(postfix_start + 1, file.size() - postfix_start);
 		//std::cout << "load a " << file_postfix << " image" << std::endl;
         if (file_postfix == "dds") {
-            DDSImage dds_image = LoadDDS(file.c_str());
-            m_Resolution.x = dds_image.width;
-            m_Resolution.y = dds_image.height;
-            m_Resolution.z = 1;
-            m_Size = dds_image.data.size() * sizeof(uint8_t);
-            m_RawData = malloc(m_Size);
-            std::memcpy(m_RawData, dds_image.data.data(), m_Size );
+            LoadDDS(file);
         }
         else {
-            stbi_set_flip_vertically_on_load(true);
+            // images may be decoded on several threads, keep the flip state thread local
+            stbi_set_flip_vertically_on_load_thread(true);
             m_RawData = stbi_load(file.c_str(),
                 &m_Resolution.x, &m_Resolution.y, &m_Resolution.z,
                 STBI_rgb_alpha);
             m_Size = m_Resolution.x * m_Resolution.y * 4 * sizeof(unsigned char);
+            stbi_set_flip_vertically_on_load_thread(false);
             if (!m_RawData) {
                 throw std::runtime_error("Failed to load texture image");
             }
-            stbi_set_flip_vertically_on_load(false);
+            m_Subresources = { ImageSubresource{ .extent = { m_Resolution.x, m_Resolution.y }, .size = m_Size } };
         }
 	}
-}
\ No newline at end of file
+
+    void Image::LoadFromFileHalf(std::string const& file)
+    {
+        Free();
+
+        // .hdr keeps its float radiance, 8 bit files are taken as is (value / 255) like the unorm textures
+        stbi_set_flip_vertically_on_load_thread(true);
+        int channels = 0;
+        void* decoded = nullptr;
+        bool is_hdr = stbi_is_hdr(file.c_str()) != 0;
+        if (is_hdr)
+        {
+            decoded = stbi_loadf(file.c_str(), &m_Resolution.x, &m_Resolution.y, &channels, STBI_rgb_alpha);
+        }
+        else
+        {
+            decoded = stbi_load(file.c_str(), &m_Resolution.x, &m_Resolution.y, &channels, STBI_rgb_alpha);
+        }
+        stbi_set_flip_vertically_on_load_thread(false);
+        if (!decoded) {
+            throw std::runtime_error("Failed to load texture image");
+        }
+
+        uint64_t count = static_cast<uint64_t>(m_Resolution.x) * m_Resolution.y * 4;
+        m_Resolution.z = 4;
+        m_Size = static_cast<uint32_t>(count * sizeof(uint16_t));
+        m_RawData = PixelBufferPool::GetInstance().Allocate(m_Size);
+        uint16_t* pixels = reinterpret_cast<uint16_t*>(m_RawData);
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            pixels[i] = FloatToHalf(is_hdr ? reinterpret_cast<float const*>(decoded)[i]
+                                           : reinterpret_cast<unsigned char const*>(decoded)[i] * (1.f / 255.f));
+        }
+        stbi_image_free(decoded);
+
+        m_Format = vk::Format::eR16G16B16A16Sfloat;
+        m_Subresources = { ImageSubresource{ .extent = { m_Resolution.x, m_Resolution.y }, .size = m_Size } };
+    }
+
+    void Image::LoadDDS(std::string const& file)
+    {
+        std::ifstream in(file, std::ios::ate | std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error("Failed to open " + file);
+        }
+        uint64_t file_size = in.tellg();
+        in.seekg(0);
+
+        DDSHeader header;
+        if (!ReadDDSHeader(in, file_size, header)) {
+            throw std::runtime_error("Invalid dds header in " + file);
+        }
+        if (header.Depth() > 1) {
+            throw std::runtime_error("Volume dds textures are not supported: " + file);
+        }
+
+        DDSFormat format = GetDDSFormat(header);
+        if (format.format == vk::Format::eUndefined) {
+            throw std::runtime_error("Unsupported dds format in " + file);
+        }
+
+        // cube maps are kept as 6 array layers per cube
+        bool is_cube = (header.HasDX10() ? (header.MiscFlag() & 0x4) : (header.Caps2() & 0x200));
+        m_LayerCount = (header.HasDX10() ? header.ArraySize() : 1) * (is_cube ? 6 : 1);
+        m_MipCount = header.MipCount();
+        m_Format = format.format;
+        m_Resolution = { static_cast<int>(header.Width()), static_cast<int>(header.Height()), 1 };
+
+        // dds stores every mip of layer 0, then every mip of layer 1, ...
+        uint64_t offset = 0;
+        for (uint32_t layer = 0; layer < m_LayerCount; ++layer)
+        {
+            for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+            {
+                glm::ivec2 extent = { std::max(m_Resolution.x >> mip, 1), std::max(m_Resolution.y >> mip, 1) };
+                uint64_t blocks_x = (extent.x + format.blockSize - 1) / format.blockSize;
+                uint64_t blocks_y = (extent.y + format.blockSize - 1) / format.blockSize;
+                uint64_t size = blocks_x * blocks_y * format.blockBytes;
+
+                m_Subresources.push_back({ mip, layer, extent, offset, size });
+                offset += size;
+            }
+        }
+
+        if (file_size - header.Size() < offset) {
+            m_Subresources.clear();
+            throw std::runtime_error("Truncated dds file " + file);
+        }
+
+        m_Size = static_cast<uint32_t>(offset);
+        m_RawData = PixelBufferPool::GetInstance().Allocate(m_Size);
+        if (!in.read(reinterpret_cast<char*>(m_RawData), m_Size)) {
+            Free();
+            throw std::runtime_error("Failed to read " + file);
+        }
+    }
+}
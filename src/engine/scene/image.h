@@ -1,19 +1,57 @@
 #pragma once
 
+#include <vulkan/vulkan.hpp>
+
 namespace VK_Renderer
 {
+	// Image properties read from the file header
+	struct ImageInfo
+	{
+		glm::ivec3 resolution{ 0 };
+		uint64_t size{ 0 }; // bytes of the decoded pixels
+		vk::Format format{ vk::Format::eUndefined }; // as Image::GetFormat after loading
+	};
+
+	// One mip level of one array layer inside the image data
+	struct ImageSubresource
+	{
+		uint32_t mipLevel{ 0 };
+		uint32_t arrayLayer{ 0 };
+		glm::ivec2 extent{ 0 };
+		uint64_t offset{ 0 };
+		uint64_t size{ 0 };
+	};
+
+	class Image;
+
+	// Non-owning view of pixels, for data borrowed from an image or an external buffer
+	struct PixelView
+	{
+		PixelView() = default;
+		PixelView(void const* data, uint32_t const& size, glm::ivec3 const& resolution, vk::Format const& format = vk::Format::eUndefined)
+			: data(data), size(size), resolution(resolution), format(format) {}
+		PixelView(Image const& image);
+
+		void const* data{ nullptr };
+		uint32_t size{ 0 };
+		glm::ivec3 resolution{ 0 };
+		vk::Format format{ vk::Format::eUndefined }; // eUndefined for 8 bit RGBA, as Image::GetFormat
+	};
+
+	// Owns its pixels, buffers come from the PixelBufferPool and are moved instead of copied
 	class Image
 	{
 	public:
-		Image() {}
-		Image(void* data,
-			uint32_t const& size,
-			glm::ivec3 const& resolution);
+		Image();
+		Image(glm::ivec3 const& resolution, uint32_t const& size);
+		// Allocate one buffer for the given mips and layers, resolution is the extent of the first subresource
+		Image(std::vector<ImageSubresource> const& subresources, vk::Format const& format = vk::Format::eUndefined);
 		Image(std::string const& file);
-		Image(const Image& img);
-		Image(Image&& img);
+		Image(Image&& img) noexcept;
 		
+		Image(const Image& img) = delete;
 		Image& operator=(const Image& img) = delete;
+		Image& operator=(Image&& img) noexcept;
 
 		virtual ~Image();
 
@@ -21,11 +59,30 @@ namespace VK_Renderer
 
 		virtual void* GetRawData() const { return m_RawData; }
 		virtual void LoadFromFile(std::string const& file);
+		// Decode any stb format to linear RGBA16F, radiance of .hdr files is kept above 1
+		void LoadFromFileHalf(std::string const& file);
 		virtual uint32_t GetSize() const { return m_Size; }
 
+		// Explicit deep copy, counted in the pool stats
+		Image Clone() const;
+
+		// Read png, jpg, bmp, hdr, tga and dds headers without decoding pixels, false if the header is
+		// unreadable or the dds format unsupported
+		static bool ReadInfo(std::string const& file, ImageInfo& info);
+
+	protected:
+		// Keep every mip and array layer of the file as stored, pixels are read straight into the buffer
+		void LoadDDS(std::string const& file);
+
 	protected:
 		void* m_RawData{ nullptr };
 		uint32_t m_Size{ 0 };
 		DeclareWithGetFunc(protected, glm::ivec3, m, Resolution, const);
+
+		// eUndefined for decoded 8 bit images, their format is chosen by the texture. eR16G16B16A16Sfloat after LoadFromFileHalf
+		DeclareWithGetFunc(protected, vk::Format, m, Format, const);
+		DeclareWithGetFunc(protected, uint32_t, m, MipCount, const);
+		DeclareWithGetFunc(protected, uint32_t, m, LayerCount, const);
+		DeclareWithGetFunc(protected, std::vector<ImageSubresource>, m, Subresources, const);
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,209 @@
+#include "imageLoader.h"
+
+namespace VK_Renderer
+{
+	glm::ivec3 PendingImage::GetResolution() const
+	{
+		return m_Resolution.get();
+	}
+
+	Image PendingImage::Get()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Loader->m_Mutex);
+			if (m_Loader->m_PendingTickets.empty() || *m_Loader->m_PendingTickets.begin() != m_Ticket)
+			{
+				throw std::logic_error("PendingImage::Get called out of load order");
+			}
+			m_Loader->m_PendingTickets.erase(m_Ticket);
+		}
+		Image image = m_Image.get();
+		{
+			std::lock_guard<std::mutex> lock(m_Loader->m_Mutex);
+			m_Loader->m_DecodedTickets.erase(m_Ticket);
+		}
+		m_Loader->Release(image.GetSize());
+		return image;
+	}
+
+	PendingImage& PendingImage::operator=(PendingImage&& other)
+	{
+		if (this != &other)
+		{
+			Abandon();
+			m_Loader = other.m_Loader;
+			m_Ticket = other.m_Ticket;
+			m_Resolution = std::move(other.m_Resolution);
+			m_Image = std::move(other.m_Image);
+		}
+		return *this;
+	}
+
+	PendingImage::~PendingImage()
+	{
+		Abandon();
+	}
+
+	void PendingImage::Abandon()
+	{
+		if (!m_Image.valid()) return;
+
+		// a held image is released here, one still decoding is released by its worker
+		if (m_Loader->Abandon(m_Ticket))
+		{
+			m_Loader->Release(m_Image.get().GetSize());
+		}
+		m_Image = {};
+	}
+
+	ImageLoader::ImageLoader(ImageLoaderCreateInfo const& info)
+		: m_MemoryBudget(info.memoryBudget), m_Pool(info.threadCount)
+	{
+	}
+
+	ImageLoader::~ImageLoader()
+	{
+	}
+
+	PendingImage ImageLoader::Load(std::string const& file)
+	{
+		auto resolution = std::make_shared<std::promise<glm::ivec3>>();
+
+		// the header is probed on the calling thread so atlas layout never waits for the queue
+		ImageInfo info;
+		bool has_header = Image::ReadInfo(file, info);
+		if (has_header) resolution->set_value(info.resolution);
+
+		PendingImage pending;
+		pending.m_Loader = this;
+		pending.m_Resolution = resolution->get_future().share();
+
+		// the ticket and the queue position are taken together so tickets reach the workers in order
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		pending.m_Ticket = m_NextTicket++;
+		m_PendingTickets.insert(pending.m_Ticket);
+		pending.m_Image = m_Pool.Submit([this, file, reserved = info.size, ticket = pending.m_Ticket, has_header, resolution]() {
+			try
+			{
+				Image image = Decode(file, reserved, ticket);
+				if (!has_header) resolution->set_value(image.GetResolution());
+				if (!Hold(ticket))
+				{
+					uint64_t size = image.GetSize();
+					image.Free();
+					Release(size);
+				}
+				return image;
+			}
+			catch (...)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					m_AbandonedTickets.erase(ticket);
+				}
+				if (!has_header) resolution->set_exception(std::current_exception());
+				throw;
+			}
+		});
+
+		return pending;
+	}
+
+	std::future<void> ImageLoader::Stream(std::string const& file, std::function<void(Image const&)> const& consumer)
+	{
+		ImageInfo info;
+		Image::ReadInfo(file, info);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Pool.Submit([this, file, reserved = info.size, ticket = m_NextTicket++, consumer]() {
+			Image image = Decode(file, reserved, ticket);
+			uint64_t size = image.GetSize();
+			try
+			{
+				consumer(image);
+			}
+			catch (...)
+			{
+				Release(size);
+				throw;
+			}
+			image.Free();
+			Release(size);
+		});
+	}
+
+	Image ImageLoader::Decode(std::string const& file, uint64_t const& reserved, uint64_t const& ticket)
+	{
+		Acquire(reserved, ticket);
+
+		Image image;
+		try
+		{
+			image.LoadFromFile(file);
+		}
+		catch (...)
+		{
+			Release(reserved);
+			throw;
+		}
+
+		// the header estimate may differ from the decoded size
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_InFlightBytes = m_InFlightBytes - reserved + image.GetSize();
+		}
+		m_BudgetCondition.notify_all();
+		return image;
+	}
+
+	bool ImageLoader::Hold(uint64_t const& ticket)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_AbandonedTickets.erase(ticket) > 0) return false;
+		m_DecodedTickets.insert(ticket);
+		return true;
+	}
+
+	bool ImageLoader::Abandon(uint64_t const& ticket)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_PendingTickets.erase(ticket);
+			if (m_DecodedTickets.erase(ticket) == 0)
+			{
+				m_AbandonedTickets.insert(ticket);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64_t ImageLoader::GetInFlightBytes()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_InFlightBytes;
+	}
+
+	void ImageLoader::Acquire(uint64_t const& bytes, uint64_t const& ticket)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		// an image larger than the budget still goes through once nothing else is in flight,
+		// a later small image never overtakes it
+		m_BudgetCondition.wait(lock, [this, &bytes, &ticket]() {
+			return ticket == m_ServingTicket && (m_InFlightBytes == 0 || m_InFlightBytes + bytes <= m_MemoryBudget);
+		});
+		m_InFlightBytes += bytes;
+		++m_ServingTicket;
+		lock.unlock();
+		m_BudgetCondition.notify_all();
+	}
+
+	void ImageLoader::Release(uint64_t const& bytes)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_InFlightBytes -= std::min(bytes, m_InFlightBytes);
+		}
+		m_BudgetCondition.notify_all();
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "image.h"
+#include "core/threadPool.h"
+#include <set>
+
+namespace VK_Renderer
+{
+	class ImageLoader;
+
+	struct ImageLoaderCreateInfo
+	{
+		uint32_t threadCount{ 0 }; // 0: hardware concurrency
+		uint64_t memoryBudget{ 1ull << 30 }; // decoded bytes allowed in flight
+	};
+
+	// Handle of an image decoded in the background. Destroying it before Get gives up its place in the load
+	// order and the budget of its pixels, it must not outlive its loader.
+	class PendingImage
+	{
+	public:
+		PendingImage() = default;
+		PendingImage(PendingImage&& other) = default;
+		PendingImage& operator=(PendingImage&& other);
+		~PendingImage();
+
+		inline bool Valid() const { return m_Image.valid(); }
+
+		// Resolution from the file header, does not wait for pixels
+		glm::ivec3 GetResolution() const;
+
+		// Block until the pixels are decoded, give their budget back to the loader.
+		// Images of a loader must be taken in the order they were loaded, see ImageLoader.
+		Image Get();
+
+	protected:
+		friend class ImageLoader;
+
+		void Abandon();
+
+	protected:
+		ImageLoader* m_Loader{ nullptr };
+		uint64_t m_Ticket{ 0 };
+		std::shared_future<glm::ivec3> m_Resolution;
+		std::future<Image> m_Image;
+	};
+
+	// Decodes images on a thread pool within a memory budget. Decodes take the budget in submission order,
+	// and a loaded image holds its share until PendingImage::Get or its destruction. Gets must follow the order of the Load
+	// calls: waiting on a later image while an earlier one is decoded but not taken can leave the budget
+	// full with nothing able to free it, so an out of order Get throws instead of deadlocking.
+	class ImageLoader
+	{
+	public:
+		ImageLoader(ImageLoaderCreateInfo const& info = {});
+		~ImageLoader();
+
+		PendingImage Load(std::string const& file);
+
+		// Decode on a worker and hand the pixels to the consumer there, the image is freed right after.
+		// The consumer runs concurrently with other consumers.
+		std::future<void> Stream(std::string const& file, std::function<void(Image const&)> const& consumer);
+
+		uint64_t GetInFlightBytes();
+
+	protected:
+		friend class PendingImage;
+
+		// wait for the turn of ticket and for bytes to fit in the budget
+		void Acquire(uint64_t const& bytes, uint64_t const& ticket);
+		void Release(uint64_t const& bytes);
+
+		// decode a file within the budget, the decoded size stays acquired
+		Image Decode(std::string const& file, uint64_t const& reserved, uint64_t const& ticket);
+
+		// keep a decoded image for Get, false if its PendingImage was destroyed during the decode
+		bool Hold(uint64_t const& ticket);
+		// drop the ticket of a destroyed PendingImage, true if its image is decoded and held
+		bool Abandon(uint64_t const& ticket);
+
+	protected:
+		std::mutex m_Mutex;
+		std::condition_variable m_BudgetCondition;
+		uint64_t m_InFlightBytes{ 0 };
+		uint64_t m_MemoryBudget;
+		// tickets in submission order, the pool runs tasks in that order so the next one is always started
+		uint64_t m_NextTicket{ 0 };
+		uint64_t m_ServingTicket{ 0 };
+		// tickets of loaded images not taken by Get yet
+		std::set<uint64_t> m_PendingTickets;
+		// tickets of images decoded and holding their budget, and of images given up while decoding
+		std::set<uint64_t> m_DecodedTickets;
+		std::set<uint64_t> m_AbandonedTickets;
+
+		MyCore::ThreadPool m_Pool;
+	};
+}
@@ -1,82 +1,19 @@
 #include "light.h"
+#include "gaussianBlur.h"
+#include "lightPyramidCache.h"
+#include "pixelBufferPool.h"
+#include "halfFloat.h"
+#include "core/threadPool.h"
 
-#include <stb_image_write.h>
 #include <format>
 #include <filesystem>
 #include "tiny_obj_loader.h"
 #include <iostream>
-#include <gaussian.cuh>
+#include <chrono>
+#include <bit>
 
 namespace VK_Renderer 
 {
-	struct Pixel
-	{
-		unsigned char r;
-		unsigned char g;
-		unsigned char b;
-		unsigned char a;
-	};
-
-	inline void GussianBlur(Pixel* const out_image, Pixel const* const input_image, glm::ivec3 const& resolution, uint8_t const& kernelHalfRadius,
-		float const* kernel)
-	{
-		int kernel_radius = ((kernelHalfRadius << 1) + 1);
-		uint16_t kernel_size = kernel_radius * kernel_radius;
-
-		// Apply Gaussian blur
-		for (int y = 0; y < resolution.y; ++y) {
-			for (int x = 0; x < resolution.x; ++x) {
-				float totalRed = 0, totalGreen = 0, totalBlue = 0, totalAlpha = 0, totalWeight = 0;
-				for (int ky = -kernelHalfRadius; ky <= kernelHalfRadius; ky++) {
-					for (int kx = -kernelHalfRadius; kx <= kernelHalfRadius; kx++) {
-						int pixelPosX = x + kx;
-						int pixelPosY = y + ky;
-
-						// Boundary check
-						if (pixelPosX >= 0 && pixelPosX < resolution.x && pixelPosY >= 0 && pixelPosY < resolution.y) {
-							Pixel const& pixel = input_image[pixelPosY * resolution.x + pixelPosX];
-							float weight = kernel[(ky + kernelHalfRadius) * kernel_radius + kx + kernelHalfRadius];
-
-							totalRed += pixel.r * weight;
-							totalGreen += pixel.g * weight;
-							totalBlue += pixel.b * weight;
-							totalAlpha += pixel.a * weight;
-							totalWeight += weight;
-						}
-					}
-				}
-
-				Pixel& newPixel = out_image[y * resolution.x + x];
-				newPixel.r = static_cast<unsigned char>(totalRed / totalWeight);
-				newPixel.g = static_cast<unsigned char>(totalGreen / totalWeight);
-				newPixel.b = static_cast<unsigned char>(totalBlue / totalWeight);
-				newPixel.a = static_cast<unsigned char>(totalAlpha / totalWeight);
-			}
-		}
-	}
-
-	std::vector<float> GetGaussianKernel(uint8_t const& kernelHalfRadius, float const& strength)
-	{
-		float sigma = strength;
-		float factor = 1.f / (2.f * glm::pi<float>() * sigma * sigma);
-		uint16_t kernel_radius = (kernelHalfRadius << 1) + 1;
-		uint16_t kernel_size = kernel_radius * kernel_radius;
-		std::vector<float> kernel(kernel_radius * kernel_radius);
-
-		float sum = 0.0;
-
-		for (int y = -kernelHalfRadius; y <= kernelHalfRadius; ++y)
-		{
-			for (int x = -kernelHalfRadius; x <= kernelHalfRadius; ++x)
-			{
-				kernel[(x + kernelHalfRadius) * kernel_radius + y + kernelHalfRadius] = (1.f / (2.f * glm::pi<float>() * sigma * sigma)) * glm::exp(-((x * x + y * y) / (2.f * sigma * sigma)));
-				sum += kernel[(y + kernelHalfRadius) * kernel_radius + x + kernelHalfRadius];
-			}
-		}
-
-		return kernel;
-	}
-
 	AreaLight::AreaLight(AreaLightCreateInfo const& createInfo)
 		: m_LightType(createInfo.type)
 		, m_LightVertex(createInfo.lightVertex)
@@ -188,15 +125,55 @@ namespace VK_Renderer
 	//--------------------
 	//SceneLight
 	//--------------------
+	SceneLight::SceneLight()
+		: m_BlurLayerCount(1), m_BlurSigma(2.f), m_BlurBackendType(BlurBackendType::CPU), m_FilterMode(LightFilterMode::Gaussian),
+		  m_TextureFormat(LightTextureFormat::RGBA8), m_UpdateBudget(4.f)
+	{
+	}
+
+	void SceneLight::SetBlurLayerCount(uint8_t const& count)
+	{
+		// the blocks of the atlas are aligned for its level count
+		if (count != m_BlurLayerCount) m_LightAtlasDirty = true;
+		m_BlurLayerCount = count;
+	}
+
 	AreaLight* SceneLight::GetLight(size_t idx)
 	{
 		if (idx > m_AreaLights.size())return nullptr;
 		return &m_AreaLights[idx];
 	}
+	// Materials with the same texture paths share one atlas block
+	static std::string GetMaterialKey(MaterialInfo const& info)
+	{
+		std::string key;
+		for (std::string const& path : info.texPath)
+		{
+			key += path;
+			key += '\n';
+		}
+		for (ScalarMapInfo const& scalar_map : info.scalarMaps)
+		{
+			key += std::format("{}:{}:{}\n", scalar_map.path, static_cast<int>(scalar_map.channel), scalar_map.defaultValue);
+		}
+		return key;
+	}
+
 	void SceneLight::AddLight(const AreaLight& lt)
 	{
-		m_AreaLights.emplace_back(lt);
-		m_MaterialInfos.emplace_back(lt.m_LightMaterial);
+		auto [it, inserted] = m_MaterialIndices.try_emplace(GetMaterialKey(lt.m_LightMaterial), static_cast<uint32_t>(m_MaterialInfos.size()));
+		if (inserted)
+		{
+			m_MaterialInfos.emplace_back(lt.m_LightMaterial);
+			m_LightAtlasDirty = true;
+		}
+
+		AreaLight& light = m_AreaLights.emplace_back(lt);
+		light.m_MaterialIndex = it->second;
+		if (!m_LightAtlasDirty)
+		{
+			UpdateLightUVs();
+		}
 	}
 
 	void SceneLight::AddQuadLightsFromFile(const std::string& objfile, Transformation const& transform) 
@@ -281,84 +258,360 @@ namespace VK_Renderer
 
 	std::vector<LightInfo> SceneLight::GetPackedLightInfo()
 	{
-		auto n = m_AreaLights.size();
-
-		//update light inform after atlas
-		auto compressedTex = GetLightTexture();//update light uvs
-		auto& texBlocks = compressedTex.GetFinishedAtlas();
-		for (int i = 0;i < texBlocks.size();++i) {
-			TextureBlock2D const& atlas = texBlocks[i];
-			glm::vec2 start = static_cast<glm::vec2>(atlas.start) / static_cast<glm::vec2>(compressedTex.GetResolution());
-			glm::vec2 end = static_cast<glm::vec2>(atlas.start + glm::ivec2(atlas.width, atlas.height)) / static_cast<glm::vec2>(compressedTex.GetResolution());
-
-			m_AreaLights[i].m_UV00 = start;
-			m_AreaLights[i].m_UV11 = end;
-		}
+		// the atlas is only built when a new material was added, the uvs are kept on the lights
+		GetLightTexture();
 
-		std::vector<LightInfo> ans(n);
-		for (auto i = 0;i < n;++i) {
+		std::vector<LightInfo> ans(m_AreaLights.size());
+		for (size_t i = 0; i < m_AreaLights.size(); ++i)
+		{
 			ans[i] = m_AreaLights[i].GetLightInfo();
 		}
-
 		return ans;
 	}
-	AtlasTexture2D SceneLight::GetLightTexture()
+
+	AtlasTexture2D const& SceneLight::GetLightTexture()
 	{
-		// Load textures
-		std::vector<Material> materials;
-		
-		void* new_image = nullptr;
-		int half_radius = 50;
-		auto gaussian_kernel = GetGaussianKernel(half_radius, 5.f);
+		if (!m_LightAtlasDirty) return *m_LightAtlas;
+		m_LightAtlasDirty = false;
+
+		// blocks aligned to the coarsest level of the pyramid, so no texel of a level is shared by two lights
+		uint32_t block_alignment = 1u << (std::max<uint32_t>(m_BlurLayerCount, 1) - 1);
+		// rebuilt in place, references handed out earlier see the new atlas
+		if (!m_LightAtlas) m_LightAtlas = mkU<AtlasTexture2D>();
 
-		for (auto const& info : m_MaterialInfos)
+		if (m_TextureFormat == LightTextureFormat::RGBA16F)
 		{
+			// decoded straight to half floats, lights only use the first texture of their material
+			std::vector<Image> images(m_MaterialInfos.size());
+			MyCore::ThreadPool::GetInstance().ParallelFor(0, static_cast<uint32_t>(images.size()), [&](uint32_t i) {
+				std::vector<std::string> const& paths = m_MaterialInfos[i].texPath;
+				if (paths.size() > 0 && paths[0].size() > 0) images[i].LoadFromFileHalf(paths[0]);
+			});
+
+			std::vector<glm::ivec2> resolutions;
+			for (Image const& image : images)
+			{
+				resolutions.push_back(glm::max(glm::ivec2(image.GetResolution().x, image.GetResolution().y), glm::ivec2(1)));
+			}
+			*m_LightAtlas = AtlasTexture2D(AtlasTexture2DCreateInfo{ .channels = 4, .channelSize = 2, .blockAlignment = block_alignment });
+			m_LightAtlas->ComputeLayout(resolutions, 1);
+			for (uint32_t i = 0; i < images.size(); ++i)
+			{
+				if (images[i].GetSize() > 0) m_LightAtlas->CopyImage(i, 0, images[i]);
+			}
+		}
+		else
+		{
+			// Load textures, decoding runs in the background
+			ImageLoader loader;
+			std::vector<Material> materials;
+			materials.reserve(m_MaterialInfos.size());
+			for (auto const& info : m_MaterialInfos)
+			{
+				materials.emplace_back(info, loader);
+			}
+			for (Material& material : materials)
+			{
+				material.Wait();
+			}
+			*m_LightAtlas = AtlasTexture2D(AtlasTexture2DCreateInfo{ .blockAlignment = block_alignment });
+			m_LightAtlas->ComputeAtlas(materials);
+		}
+
+		// frames given before the rebuild replace the textures of their lights again
+		for (auto const& [material_index, frame] : m_LightFrames)
+		{
+			m_LightAtlas->CopyImage(material_index, 0, frame);
+		}
+		UpdateLightUVs();
+		return *m_LightAtlas;
+	}
+
+	void SceneLight::UpdateLightUVs()
+	{
+		std::vector<TextureBlock2D> const& blocks = m_LightAtlas->GetFinishedAtlas();
+		glm::vec2 resolution = static_cast<glm::vec2>(m_LightAtlas->GetResolution());
+		for (AreaLight& light : m_AreaLights)
+		{
+			if (light.m_MaterialIndex >= blocks.size()) continue;
+			TextureBlock2D const& block = blocks[light.m_MaterialIndex];
+			light.m_UV00 = static_cast<glm::vec2>(block.start) / resolution;
+			light.m_UV11 = static_cast<glm::vec2>(block.start + glm::ivec2(block.width, block.height)) / resolution;
+		}
+	}
 
-			std::string filename = info.texPath[0];
-			size_t pos = filename.find('.');
+	// Blur (in texels of level) added to level after halving level - 1 so the total blur is sigma * 2^level
+	// texels of level 0. Level 0 is left sharp, so level 1 starts from no blur. Halving with a 2 texel box
+	// adds a variance of 1/4 texel of level - 1.
+	static float GetPyramidLevelSigma(uint32_t const& level, float const& sigma)
+	{
+		float scale = static_cast<float>(1 << level);
+		float previous_sigma = (level > 1 ? sigma * scale * 0.5f : 0.f);
+		float target_variance = sigma * scale * sigma * scale;
+		float box_variance = scale * scale * 0.0625f;
+		float variance = std::max(target_variance - previous_sigma * previous_sigma - box_variance, 0.f);
+		return std::sqrt(variance) / scale;
+	}
 
-			if (pos != std::string::npos) 
+	// Levels 1..levelCount-1 of one light, each one halves the previous level and blurs it
+	static LightLevels BuildLightLevels(std::vector<unsigned char> const& source, glm::ivec2 const& resolution, uint32_t const& texelSize,
+										uint32_t const& levelCount, float const& sigma, LightFilterMode const& mode, BlurBackend& blurBackend)
+	{
+		LightLevels levels;
+		levels.reserve(levelCount); // previous points into levels
+		std::vector<unsigned char> const* previous = &source;
+		glm::ivec2 previous_resolution = resolution;
+		for (uint32_t level = 1; level < levelCount; ++level)
+		{
+			glm::ivec2 level_resolution = LightPyramidCache::GetLevelResolution(resolution, level);
+			std::vector<unsigned char> downsampled(level_resolution.x * level_resolution.y * texelSize);
+			bool half_float = (texelSize == 8);
+			if (half_float)
 			{
-				filename.insert(pos, "{}");
+				DownsampleAreaHalf(downsampled.data(), level_resolution, previous->data(), previous_resolution);
+			}
+			else
+			{
+				DownsampleArea(downsampled.data(), level_resolution, previous->data(), previous_resolution);
 			}
 
-			Material material(info);
-			uint32_t size = material.GetTextures()[0].GetSize();
-			glm::ivec3 resolution = material.GetTextures()[0].GetResolution();
-			
-			for (int i = 1; i < m_BlurLayerCount; ++i)
+			// the blur renormalizes at the light's border so the atlas neighbours never bleed in
+			float level_sigma = GetPyramidLevelSigma(level, sigma);
+			std::vector<unsigned char>& blurred = levels.emplace_back(downsampled.size());
+			if (half_float)
 			{
-				std::string file_i = std::vformat(filename, std::make_format_args(i));
+				int half_radius = static_cast<int>(std::ceil(3.f * level_sigma));
+				std::shared_ptr<std::vector<float> const> kernel = GetCachedGaussianKernel1D(half_radius, level_sigma);
+				GaussianBlurSeparableHalf(blurred.data(), downsampled.data(), level_resolution, half_radius, kernel->data(), MyCore::ThreadPool::GetInstance());
+			}
+			else if (mode == LightFilterMode::BoxCascade)
+			{
+				BoxBlurCascade(blurred.data(), downsampled.data(), level_resolution, level_sigma, MyCore::ThreadPool::GetInstance());
+			}
+			else
+			{
+				int half_radius = static_cast<int>(std::ceil(3.f * level_sigma));
+				std::shared_ptr<std::vector<float> const> kernel = GetCachedGaussianKernel1D(half_radius, level_sigma);
+				blurBackend.Blur(blurred.data(), downsampled.data(), level_resolution, half_radius, kernel->data(), BlurBorder::Renormalize);
+			}
 
-				if (std::filesystem::exists({ file_i }))
-				{
-					// if the image exist, read it from file
-					material.AddImage({ file_i });
-				}
-				else
-				{
-					// Blur the last image
-					new_image = new unsigned char[size];
-
-					// blur texture			
-					//GussianBlur(reinterpret_cast<Pixel*>(new_image),
-					//			reinterpret_cast<Pixel*>(material.GetTextures()[i - 1].GetRawData()),
-					//			resolution, half_radius, gaussian_kernel.data());
-					
-					CUDA_Helper::GaussianBlur(new_image, material.GetTextures()[i - 1].GetRawData(), resolution.x, resolution.y, half_radius, gaussian_kernel.data());
-
-					stbi_flip_vertically_on_write(true);
-					stbi_write_png(file_i.c_str(), resolution.x, resolution.y, 4, new_image, resolution.x * 4);
-					stbi_flip_vertically_on_write(false);
-
-					material.AddImage({ new_image, size, resolution });
-
-					new_image = nullptr;
-					// save image to file
-				}
+			previous = &levels.back();
+			previous_resolution = level_resolution;
+		}
+		return levels;
+	}
+
+	// Levels of the pyramid of an atlas, at most down to 1x1. Level i needs block origins that are multiples
+	// of 2^i, beyond that two lights would write the same texels.
+	static uint32_t GetPyramidLevelCount(glm::ivec2 const& resolution, uint32_t const& requestedCount, uint32_t const& blockAlignment)
+	{
+		uint32_t max_level_count = 1;
+		while ((std::max(resolution.x, resolution.y) >> max_level_count) > 0) ++max_level_count;
+		max_level_count = std::min<uint32_t>(max_level_count, std::countr_zero(std::max(blockAlignment, 1u)) + 1);
+		return std::clamp<uint32_t>(requestedCount, 1, max_level_count);
+	}
+
+	// Copy the block of a light out of level 0 of the atlas
+	static std::vector<unsigned char> GetBlockSource(unsigned char const* atlasData, glm::ivec2 const& atlasResolution,
+													TextureBlock2D const& block, uint32_t const& texelSize)
+	{
+		std::vector<unsigned char> source(block.width * block.height * texelSize);
+		PixelBufferPool::GetInstance().RecordCopy(source.size());
+		for (uint32_t y = 0; y < block.height; ++y)
+		{
+			std::memcpy(source.data() + y * block.width * texelSize,
+				atlasData + ((block.start.y + y) * atlasResolution.x + block.start.x) * texelSize, block.width * texelSize);
+		}
+		return source;
+	}
+
+	// Block rectangle [begin, end) in a level of extent levelExtent, rounded outwards. The light atlas aligns
+	// blocks to the pyramid, so the rectangles of different blocks never overlap and can be written in parallel.
+	static void GetLevelRect(TextureBlock2D const& block, uint32_t const& level, glm::ivec2 const& levelExtent,
+							glm::ivec2& begin, glm::ivec2& end)
+	{
+		begin = glm::ivec2(block.start.x >> level, block.start.y >> level);
+		end = glm::ivec2((block.start.x + static_cast<int>(block.width) + (1 << level) - 1) >> level,
+						(block.start.y + static_cast<int>(block.height) + (1 << level) - 1) >> level);
+		end = glm::min(end, levelExtent);
+	}
+
+	// Fill a rectangle of size extent, dst rows are dstWidth texels apart. The rectangle can be one texel
+	// larger than the level of the light, the extra texel repeats the light's edge.
+	static void CopyLightLevel(unsigned char* dst, int const& dstWidth, glm::ivec2 const& extent,
+								unsigned char const* levelSource, glm::ivec2 const& levelResolution, uint32_t const& texelSize)
+	{
+		PixelBufferPool::GetInstance().RecordCopy(static_cast<uint64_t>(extent.x) * extent.y * texelSize);
+		for (int y = 0; y < extent.y; ++y)
+		{
+			int src_y = std::min(y, levelResolution.y - 1);
+			for (int x = 0; x < extent.x; ++x)
+			{
+				int src_x = std::min(x, levelResolution.x - 1);
+				std::memcpy(dst + (y * dstWidth + x) * texelSize, levelSource + (src_y * levelResolution.x + src_x) * texelSize, texelSize);
+			}
+		}
+	}
+
+	Image SceneLight::GetLightPyramid(AtlasTexture2D const& atlas)
+	{
+		glm::ivec2 const& resolution = atlas.GetResolution();
+		if (resolution.x * resolution.y == 0) return {};
+
+		uint32_t level_count = GetPyramidLevelCount(resolution, m_BlurLayerCount, atlas.GetBlockAlignment());
+		uint32_t texel_size = atlas.GetTexelSize();
+
+		std::vector<ImageSubresource> levels;
+		uint64_t offset = 0;
+		for (uint32_t level = 0; level < level_count; ++level)
+		{
+			glm::ivec2 extent = glm::max(glm::ivec2(resolution.x >> level, resolution.y >> level), glm::ivec2(1));
+			uint64_t size = static_cast<uint64_t>(extent.x) * extent.y * texel_size;
+			levels.push_back({ level, 0, extent, offset, size });
+			offset += size;
+		}
+
+		Image pyramid(levels, texel_size == 8 ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eUndefined);
+		unsigned char* data = reinterpret_cast<unsigned char*>(pyramid.GetRawData());
+		PixelBufferPool::GetInstance().Copy(data, atlas.GetData().data(), levels[0].size);
+
+		uPtr<BlurBackend> blur_backend = BlurBackend::Create(m_BlurBackendType);
+		LightPyramidCache cache;
+
+		// lights missing from the cache are generated in parallel, each blur also spreads over the pool
+		std::vector<TextureBlock2D> const& blocks = atlas.GetFinishedAtlas();
+		MyCore::ThreadPool::GetInstance().ParallelFor(0, static_cast<uint32_t>(blocks.size()), [&](uint32_t i) {
+			TextureBlock2D const& block = blocks[i];
+			glm::ivec2 block_resolution(block.width, block.height);
+			std::vector<unsigned char> source = GetBlockSource(data, resolution, block, texel_size);
+
+			LightPyramidKey key{
+				.sourceHash = LightPyramidCache::Hash(source.data(), source.size()),
+				.resolution = block_resolution,
+				.levelCount = level_count,
+				.sigma = m_BlurSigma,
+				.filterMode = static_cast<uint32_t>(m_FilterMode),
+				.texelSize = texel_size
+			};
+			LightLevels light_levels;
+			if (!cache.Load(key, light_levels))
+			{
+				light_levels = BuildLightLevels(source, block_resolution, texel_size, level_count, m_BlurSigma, m_FilterMode, *blur_backend);
+				cache.Store(key, light_levels);
 			}
-			materials.push_back(material);
+
+			for (uint32_t level = 1; level < level_count; ++level)
+			{
+				glm::ivec2 const& extent = levels[level].extent;
+				glm::ivec2 begin, end;
+				GetLevelRect(block, level, extent, begin, end);
+				CopyLightLevel(data + levels[level].offset + (begin.y * extent.x + begin.x) * texel_size, extent.x, end - begin,
+								light_levels[level - 1].data(), LightPyramidCache::GetLevelResolution(block_resolution, level), texel_size);
+			}
+		});
+		return pyramid;
+	}
+
+	bool SceneLight::SubmitLightFrame(uint32_t const& lightIndex, PixelView const& frame)
+	{
+		if (lightIndex >= m_AreaLights.size() || frame.data == nullptr || frame.resolution.x <= 0 || frame.resolution.y <= 0) return false;
+
+		// 8 bit RGBA or RGBA16F frames, converted to the light texture format like LoadFromFileHalf does
+		bool frame_half = (frame.format == vk::Format::eR16G16B16A16Sfloat);
+		bool frame_rgba8 = (frame.format == vk::Format::eUndefined || frame.format == vk::Format::eR8G8B8A8Unorm || frame.format == vk::Format::eR8G8B8A8Srgb);
+		uint64_t value_count = static_cast<uint64_t>(frame.resolution.x) * frame.resolution.y * 4;
+		if (!(frame_half || frame_rgba8) || frame.size < value_count * (frame_half ? sizeof(uint16_t) : sizeof(unsigned char))) return false;
+
+		bool atlas_half = (m_TextureFormat == LightTextureFormat::RGBA16F);
+		uint64_t size = value_count * (atlas_half ? sizeof(uint16_t) : sizeof(unsigned char));
+		ImageSubresource subresource{ .extent = { frame.resolution.x, frame.resolution.y }, .size = size };
+
+		// the latest frame is kept for atlas rebuilds, until then it only goes to the current atlas
+		uint32_t material_index = m_AreaLights[lightIndex].m_MaterialIndex;
+		Image& kept_frame = m_LightFrames[material_index];
+		kept_frame = Image({ subresource }, atlas_half ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eUndefined);
+		if (frame_half == atlas_half)
+		{
+			PixelBufferPool::GetInstance().Copy(kept_frame.GetRawData(), frame.data, size);
+		}
+		else if (atlas_half)
+		{
+			unsigned char const* src = reinterpret_cast<unsigned char const*>(frame.data);
+			uint16_t* dst = reinterpret_cast<uint16_t*>(kept_frame.GetRawData());
+			for (uint64_t i = 0; i < value_count; ++i) dst[i] = FloatToHalf(src[i] * (1.f / 255.f));
+		}
+		else
+		{
+			uint16_t const* src = reinterpret_cast<uint16_t const*>(frame.data);
+			unsigned char* dst = reinterpret_cast<unsigned char*>(kept_frame.GetRawData());
+			for (uint64_t i = 0; i < value_count; ++i) dst[i] = static_cast<unsigned char>(glm::clamp(HalfToFloat(src[i]), 0.f, 1.f) * 255.f + 0.5f);
+		}
+		if (!m_LightAtlasDirty) m_LightAtlas->CopyImage(material_index, 0, kept_frame);
+
+		// a light that is already waiting keeps its place, its newest frame is used
+		if (std::find(m_PendingMaterials.begin(), m_PendingMaterials.end(), material_index) == m_PendingMaterials.end())
+		{
+			m_PendingMaterials.push_back(material_index);
+		}
+		return true;
+	}
+
+	LightTextureUpdate SceneLight::UpdateLightTextures()
+	{
+		LightTextureUpdate update;
+		// regions of a stale atlas would not match the uploaded texture, frames wait for GetLightTexture
+		if (m_LightAtlasDirty || m_PendingMaterials.empty()) return update;
+
+		glm::ivec2 const& resolution = m_LightAtlas->GetResolution();
+		uint32_t level_count = GetPyramidLevelCount(resolution, m_BlurLayerCount, m_LightAtlas->GetBlockAlignment());
+		uint32_t texel_size = m_LightAtlas->GetTexelSize();
+		if (!m_UpdateBlurBackend || m_UpdateBlurBackend->GetType() != m_BlurBackendType)
+		{
+			m_UpdateBlurBackend = BlurBackend::Create(m_BlurBackendType);
+		}
+
+		std::vector<TextureBlock2D> const& blocks = m_LightAtlas->GetFinishedAtlas();
+		auto begin_time = std::chrono::steady_clock::now();
+		size_t processed = 0;
+		for (; processed < m_PendingMaterials.size(); ++processed)
+		{
+			TextureBlock2D const& block = blocks[m_PendingMaterials[processed]];
+			glm::ivec2 block_resolution(block.width, block.height);
+
+			// always make progress, then only take lights the remaining budget is expected to cover
+			double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+			double estimate = m_UpdateCostPerTexel * block.width * block.height;
+			if (processed > 0 && elapsed + estimate > m_UpdateBudget) break;
+
+			auto light_begin = std::chrono::steady_clock::now();
+			std::vector<unsigned char> source = GetBlockSource(m_LightAtlas->GetData().data(), resolution, block, texel_size);
+			// frames change every update, so they skip the disk cache
+			LightLevels light_levels = BuildLightLevels(source, block_resolution, texel_size, level_count, m_BlurSigma, m_FilterMode, *m_UpdateBlurBackend);
+
+			for (uint32_t level = 0; level < level_count; ++level)
+			{
+				glm::ivec2 extent = glm::max(glm::ivec2(resolution.x >> level, resolution.y >> level), glm::ivec2(1));
+				glm::ivec2 rect_begin, rect_end;
+				GetLevelRect(block, level, extent, rect_begin, rect_end);
+				glm::ivec2 rect_extent = rect_end - rect_begin;
+
+				LightTextureRegion& region = update.regions.emplace_back(LightTextureRegion{
+					.level = level,
+					.offset = rect_begin,
+					.extent = rect_extent,
+					.dataOffset = update.data.size()
+				});
+				update.data.resize(region.dataOffset + static_cast<uint64_t>(rect_extent.x) * rect_extent.y * texel_size);
+				unsigned char const* level_source = (level == 0 ? source.data() : light_levels[level - 1].data());
+				CopyLightLevel(update.data.data() + region.dataOffset, rect_extent.x, rect_extent,
+								level_source, LightPyramidCache::GetLevelResolution(block_resolution, level), texel_size);
+			}
+
+			double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - light_begin).count()
+						/ (static_cast<double>(block.width) * block.height);
+			m_UpdateCostPerTexel = (m_UpdateCostPerTexel > 0.0 ? 0.75 * m_UpdateCostPerTexel + 0.25 * cost : cost);
 		}
-		return AtlasTexture2D(materials);
+		m_PendingMaterials.erase(m_PendingMaterials.begin(), m_PendingMaterials.begin() + processed);
+		return update;
 	}
 }
\ No newline at end of file
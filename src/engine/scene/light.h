@@ -4,6 +4,7 @@
 #include "transformation.h"
 #include "material.h"
 #include "atlasTexture.h"
+#include "blurBackend.h"
 #include <vector>
 #include <array>
 namespace VK_Renderer
@@ -24,6 +25,36 @@ namespace VK_Renderer
 		BEZIER
 	};
 
+	// How light texture levels are blurred
+	enum class LightFilterMode : uint8_t
+	{
+		Gaussian = 0,	// separable Gaussian on the blur backend
+		BoxCascade = 1	// three box filters with running sums, cost independent of the width
+	};
+
+	// Storage of light textures, RGBA16F keeps .hdr radiance and avoids banding in the blurred levels
+	enum class LightTextureFormat : uint8_t
+	{
+		RGBA8 = 0,
+		RGBA16F = 1
+	};
+
+	// Part of one pyramid level to upload, texels are in the light texture format
+	struct LightTextureRegion
+	{
+		uint32_t level{ 0 };
+		glm::ivec2 offset{ 0, 0 };	// in texels of the level
+		glm::ivec2 extent{ 0, 0 };
+		uint64_t dataOffset{ 0 };	// in bytes into LightTextureUpdate::data
+	};
+
+	// Updated rectangles of the light pyramid, each region is tightly packed in data
+	struct LightTextureUpdate
+	{
+		std::vector<unsigned char> data;
+		std::vector<LightTextureRegion> regions;
+	};
+
 	struct AreaLightCreateInfo
 	{
 		LIGHT_TYPE type;
@@ -46,6 +77,8 @@ namespace VK_Renderer
 		glm::vec4 m_BoundarySphere;
 		glm::vec2 m_UV00 = { 0,0 };
 		glm::vec2 m_UV11 = { 1,1 };
+		// index into the unique materials of the SceneLight
+		uint32_t m_MaterialIndex = 0;
 	public:
 		float m_Amplitude;
 		Transformation m_Transform;
@@ -59,16 +92,65 @@ namespace VK_Renderer
 	class SceneLight {
 	private:
 		std::vector<AreaLight> m_AreaLights;
+		// unique light materials by texture path, lights refer to them by index
 		std::vector<MaterialInfo> m_MaterialInfos;
+		std::unordered_map<std::string, uint32_t> m_MaterialIndices;
+		// atlas of m_MaterialInfos, built on first use and rebuilt in place once a new material is added
+		uPtr<AtlasTexture2D> m_LightAtlas;
+		bool m_LightAtlasDirty{ true };
+		// latest frame of each material given one, copied again into a rebuilt atlas
+		std::unordered_map<uint32_t, Image> m_LightFrames;
+		// materials whose atlas block got a new frame and still need their levels rebuilt, oldest first
+		std::vector<uint32_t> m_PendingMaterials;
+		// kept between updates so dynamic lights don't rerun the backend conformance check
+		uPtr<BlurBackend> m_UpdateBlurBackend;
+		// measured cost of rebuilding the levels of one texel, used to stay within the budget
+		double m_UpdateCostPerTexel{ 0.0 };
 	public:
+		SceneLight();
+
 		AreaLight* GetLight(size_t idx);
 		void AddLight(const AreaLight& lt);
 		void AddQuadLightsFromFile(const std::string& objfile, Transformation const& transform);
 		inline uint32_t GetLightCount()const { return m_AreaLights.size(); };
+		inline uint32_t GetMaterialCount()const { return m_MaterialInfos.size(); };
+		// Only packs the lights once the atlas exists, cheap enough to call every frame
 		std::vector<LightInfo> GetPackedLightInfo();
-		AtlasTexture2D GetLightTexture();
+		// Unfiltered light textures packed into one atlas, one block per unique material. The reference stays
+		// valid, after AddLight with a new material the next call rebuilds the atlas in place and its
+		// pyramid has to be fetched and uploaded again.
+		AtlasTexture2D const& GetLightTexture();
+		// Mip chain of the atlas, level 0 is the unfiltered atlas and level i >= 1 is level i - 1 halved and
+		// blurred so its total blur is BlurSigma * 2^i texels of level 0, which is what FetchLight in
+		// mesh_ltc.frag expects.
+		// Levels of each light are cached under caches/lights.
+		Image GetLightPyramid(AtlasTexture2D const& atlas);
+
+		// Replace the texture of a light (and of every light sharing its material) with a new frame, resampled
+		// to its atlas block. 8 bit RGBA and RGBA16F frames are converted to the light texture format, others
+		// or a buffer smaller than the resolution return false. The frame is kept, so it survives atlas rebuilds.
+		bool SubmitLightFrame(uint32_t const& lightIndex, PixelView const& frame);
+		inline bool HasPendingLightFrames() const { return !m_PendingMaterials.empty(); }
+		// Rebuild the levels of lights with new frames until UpdateBudget is used, at least one per call.
+		// Returns the rectangles of the pyramid to upload, the others are left for the next calls.
+		// Nothing is returned while the atlas waits for a rebuild by GetLightTexture.
+		LightTextureUpdate UpdateLightTextures();
 
 	protected:
-		DeclareWithGetSetFunc(protected, uint8_t, m, BlurLayerCount, const);
+		// Point the uvs of every light at the block of its material
+		void UpdateLightUVs();
+
+		// number of pyramid levels, setting another count rebuilds the atlas on the next GetLightTexture
+		DeclareWithGetFunc(protected, uint8_t, m, BlurLayerCount, const);
+		void SetBlurLayerCount(uint8_t const& count);
+		// matches LIGHT_BASE_SIGMA in mesh_ltc.frag
+		DeclareWithGetSetFunc(protected, float, m, BlurSigma, const);
+		// backend used to prefilter light textures, unavailable ones fall back to the CPU
+		DeclareWithGetSetFunc(protected, BlurBackendType, m, BlurBackendType, const);
+		DeclareWithGetSetFunc(protected, LightFilterMode, m, FilterMode, const);
+		// set before the first GetLightTexture, RGBA16F always blurs with the CPU Gaussian
+		DeclareWithGetSetFunc(protected, LightTextureFormat, m, TextureFormat, const);
+		// milliseconds UpdateLightTextures may spend per call
+		DeclareWithGetSetFunc(protected, float, m, UpdateBudget, const);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "lightPyramidCache.h"
+
+#include <thread>
+
+namespace VK_Renderer
+{
+	// bump when the filtering changes so old entries are never read
+	static constexpr uint32_t LightPyramidVersion = 4;
+	static constexpr uint32_t LightPyramidMagic = 0x5259504c; // "LPYR"
+
+	struct LightPyramidHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		int32_t width;
+		int32_t height;
+		uint32_t levelCount;
+		float sigma;
+		uint32_t filterMode;
+		uint32_t texelSize;
+		uint64_t dataSize;
+	};
+
+	static uint64_t GetLevelsSize(LightPyramidKey const& key)
+	{
+		uint64_t size = 0;
+		for (uint32_t level = 1; level < key.levelCount; ++level)
+		{
+			glm::ivec2 resolution = LightPyramidCache::GetLevelResolution(key.resolution, level);
+			size += static_cast<uint64_t>(resolution.x) * resolution.y * key.texelSize;
+		}
+		return size;
+	}
+
+	LightPyramidCache::LightPyramidCache(std::string const& directory)
+		: m_Directory(directory)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_Directory, error);
+	}
+
+	uint64_t LightPyramidCache::Hash(void const* data, uint64_t const& size, uint64_t const& seed)
+	{
+		// FNV-1a over 8 byte words with a final avalanche, fast enough to hash every light on load
+		uint64_t const prime = 0x100000001b3ull;
+		uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+		unsigned char const* bytes = reinterpret_cast<unsigned char const*>(data);
+
+		uint64_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i, 8);
+			hash = (hash ^ word) * prime;
+			hash ^= hash >> 29;
+		}
+		for (; i < size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * prime;
+		}
+		hash ^= size;
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	glm::ivec2 LightPyramidCache::GetLevelResolution(glm::ivec2 const& resolution, uint32_t const& level)
+	{
+		return glm::ivec2(std::max((resolution.x + (1 << level) - 1) >> level, 1),
+						  std::max((resolution.y + (1 << level) - 1) >> level, 1));
+	}
+
+	std::string LightPyramidCache::GetPath(LightPyramidKey const& key) const
+	{
+		uint64_t key_hash = Hash(&key.resolution, sizeof(key.resolution), key.sourceHash);
+		key_hash = Hash(&key.levelCount, sizeof(key.levelCount), key_hash);
+		key_hash = Hash(&key.sigma, sizeof(key.sigma), key_hash);
+		key_hash = Hash(&key.filterMode, sizeof(key.filterMode), key_hash);
+		key_hash = Hash(&key.texelSize, sizeof(key.texelSize), key_hash ^ LightPyramidVersion);
+		return std::format("{}/{:016x}.lpyr", m_Directory, key_hash);
+	}
+
+	bool LightPyramidCache::Load(LightPyramidKey const& key, LightLevels& levels) const
+	{
+		std::ifstream in(GetPath(key), std::ios::binary);
+		if (!in.is_open()) return false;
+
+		LightPyramidHeader header;
+		if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+
+		// stale or colliding entry
+		if (header.magic != LightPyramidMagic || header.version != LightPyramidVersion ||
+			header.sourceHash != key.sourceHash || header.width != key.resolution.x || header.height != key.resolution.y ||
+			header.levelCount != key.levelCount || header.sigma != key.sigma || header.filterMode != key.filterMode ||
+			header.texelSize != key.texelSize || header.dataSize != GetLevelsSize(key))
+		{
+			return false;
+		}
+
+		levels.resize(key.levelCount > 0 ? key.levelCount - 1 : 0);
+		for (uint32_t level = 1; level < key.levelCount; ++level)
+		{
+			glm::ivec2 resolution = GetLevelResolution(key.resolution, level);
+			std::vector<unsigned char>& data = levels[level - 1];
+			data.resize(static_cast<uint64_t>(resolution.x) * resolution.y * key.texelSize);
+			if (!in.read(reinterpret_cast<char*>(data.data()), data.size()))
+			{
+				levels.clear();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void LightPyramidCache::Store(LightPyramidKey const& key, LightLevels const& levels) const
+	{
+		LightPyramidHeader header{
+			.magic = LightPyramidMagic,
+			.version = LightPyramidVersion,
+			.sourceHash = key.sourceHash,
+			.width = key.resolution.x,
+			.height = key.resolution.y,
+			.levelCount = key.levelCount,
+			.sigma = key.sigma,
+			.filterMode = key.filterMode,
+			.texelSize = key.texelSize,
+			.dataSize = GetLevelsSize(key)
+		};
+
+		std::string path = GetPath(key);
+		std::string temp_path = std::format("{}.{}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		bool written = false;
+		{
+			std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+			if (!out.is_open()) return;
+			out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+			for (std::vector<unsigned char> const& data : levels)
+			{
+				out.write(reinterpret_cast<char const*>(data.data()), data.size());
+			}
+			written = static_cast<bool>(out);
+		}
+
+		std::error_code error;
+		if (written) std::filesystem::rename(temp_path, path, error);
+		if (!written || error) std::filesystem::remove(temp_path, error);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace VK_Renderer
+{
+	// Everything the prefiltered levels of one light depend on
+	struct LightPyramidKey
+	{
+		uint64_t sourceHash{ 0 }; // hash of the level 0 pixels
+		glm::ivec2 resolution{ 0 };
+		uint32_t levelCount{ 0 };
+		float sigma{ 0.f };
+		uint32_t filterMode{ 0 }; // LightFilterMode
+		uint32_t texelSize{ 4 }; // 4 for RGBA8, 8 for RGBA16F
+	};
+
+	// Levels 1..levelCount-1 of a light, RGBA8 or RGBA16F, level i is max(1, ceil(resolution / 2^i))
+	typedef std::vector<std::vector<unsigned char>> LightLevels;
+
+	// Content addressed cache of prefiltered light levels. Entries are named after the hash of the key
+	// and store the full key, a mismatching or truncated entry is treated as stale and regenerated.
+	class LightPyramidCache
+	{
+	public:
+		LightPyramidCache(std::string const& directory = "caches/lights");
+
+		bool Load(LightPyramidKey const& key, LightLevels& levels) const;
+		// Safe to call from several threads, entries are written to a temporary file and renamed
+		void Store(LightPyramidKey const& key, LightLevels const& levels) const;
+
+		static uint64_t Hash(void const* data, uint64_t const& size, uint64_t const& seed = 0);
+		static glm::ivec2 GetLevelResolution(glm::ivec2 const& resolution, uint32_t const& level);
+
+	protected:
+		std::string GetPath(LightPyramidKey const& key) const;
+
+	protected:
+		std::string m_Directory;
+	};
+}
@@ -1,4 +1,5 @@
 #include "material.h"
+#include "pixelBufferPool.h"
 
 namespace VK_Renderer
 {
@@ -6,12 +7,21 @@ namespace VK_Renderer
 	{
 		Load(info);
 	}
+	Material::Material(MaterialInfo const& info, ImageLoader& loader)
+	{
+		LoadAsync(info, loader);
+	}
 	Material::~Material()
 	{
+		Free();
 	}
 	void Material::Free()
 	{
-
+		// pending images give their budget and load order back to the loader when destroyed
+		m_ScalarMaps.clear();
+		m_PendingTextures.clear();
+		m_PendingScalarMaps.clear();
+		m_Textures.clear();
 	}
 	void Material::Load(MaterialInfo const& info)
 	{
@@ -20,9 +30,129 @@ namespace VK_Renderer
 		{
 			if(info.texPath[i].size() > 0) m_Textures[i].LoadFromFile(info.texPath[i]);
 		}
+
+		m_ScalarMaps = info.scalarMaps;
+		m_LayerCount = info.texPath.size() + (m_ScalarMaps.size() > 0 ? 1 : 0);
+		if (m_ScalarMaps.size() > 0)
+		{
+			std::vector<Image> sources(m_ScalarMaps.size());
+			for (size_t i = 0; i < m_ScalarMaps.size(); ++i)
+			{
+				if (m_ScalarMaps[i].path.size() > 0) sources[i].LoadFromFile(m_ScalarMaps[i].path);
+			}
+			PackScalarLayer(sources);
+		}
 	}
-	void Material::AddImage(Image const&& image)
+	void Material::LoadAsync(MaterialInfo const& info, ImageLoader& loader)
+	{
+		Free();
+
+		m_PendingTextures.resize(info.texPath.size());
+		for (size_t i = 0; i < info.texPath.size(); ++i)
+		{
+			if (info.texPath[i].size() > 0) m_PendingTextures[i] = loader.Load(info.texPath[i]);
+		}
+
+		m_ScalarMaps = info.scalarMaps;
+		m_LayerCount = info.texPath.size() + (m_ScalarMaps.size() > 0 ? 1 : 0);
+		m_PendingScalarMaps.resize(m_ScalarMaps.size());
+		for (size_t i = 0; i < m_ScalarMaps.size(); ++i)
+		{
+			if (m_ScalarMaps[i].path.size() > 0) m_PendingScalarMaps[i] = loader.Load(m_ScalarMaps[i].path);
+		}
+	}
+	void Material::Wait()
+	{
+		if (m_PendingTextures.size() > 0)
+		{
+			m_Textures.clear();
+			m_Textures.reserve(m_PendingTextures.size());
+			for (PendingImage& pending : m_PendingTextures)
+			{
+				if (pending.Valid()) m_Textures.emplace_back(pending.Get());
+				else m_Textures.emplace_back();
+			}
+			m_PendingTextures.clear();
+		}
+
+		if (m_ScalarMaps.size() > 0 && m_PendingScalarMaps.size() > 0)
+		{
+			std::vector<Image> sources;
+			sources.reserve(m_PendingScalarMaps.size());
+			for (PendingImage& pending : m_PendingScalarMaps)
+			{
+				if (pending.Valid()) sources.emplace_back(pending.Get());
+				else sources.emplace_back();
+			}
+			m_PendingScalarMaps.clear();
+			PackScalarLayer(sources);
+		}
+	}
+	void Material::AddImage(Image&& image)
 	{
 		m_Textures.emplace_back(std::move(image));
 	}
-}
\ No newline at end of file
+
+	glm::ivec3 Material::GetResolution() const
+	{
+		if (m_PendingTextures.size() > 0)
+		{
+			return (m_PendingTextures[0].Valid() ? m_PendingTextures[0].GetResolution() : glm::ivec3(0));
+		}
+		return (m_Textures.size() > 0 ? m_Textures[0].GetResolution() : glm::ivec3(0));
+	}
+
+	void Material::PackScalarLayer(std::vector<Image> const& sources)
+	{
+		// the packed layer shares the resolution of the first layer so the atlas can copy it as is
+		glm::ivec3 resolution = (m_Textures.size() > 0 ? m_Textures[0].GetResolution() : glm::ivec3(0));
+		for (size_t i = 0; i < sources.size() && resolution.x * resolution.y == 0; ++i)
+		{
+			resolution = sources[i].GetResolution();
+		}
+		if (resolution.x * resolution.y == 0)
+		{
+			m_Textures.emplace_back();
+			return;
+		}
+
+		uint32_t pixel_count = resolution.x * resolution.y;
+		uint32_t size = pixel_count * 4 * sizeof(unsigned char);
+		Image packed_image(glm::ivec3(resolution.x, resolution.y, 4), size);
+		unsigned char* packed = reinterpret_cast<unsigned char*>(packed_image.GetRawData());
+
+		std::array<uint8_t, 4> defaults = { 0, 0, 0, 255 };
+		for (ScalarMapInfo const& map : m_ScalarMaps)
+		{
+			defaults[static_cast<uint8_t>(map.channel)] = map.defaultValue;
+		}
+		for (uint32_t p = 0; p < pixel_count; ++p)
+		{
+			std::memcpy(packed + p * 4, defaults.data(), 4);
+		}
+
+		for (size_t i = 0; i < sources.size(); ++i)
+		{
+			Image const& source = sources[i];
+			if (source.GetSize() == 0) continue;
+
+			uint8_t channel = static_cast<uint8_t>(m_ScalarMaps[i].channel);
+
+			// scalar maps are stored as grey images, take the red channel and resample with nearest filtering
+			glm::ivec3 const& src_res = source.GetResolution();
+			unsigned char const* src = reinterpret_cast<unsigned char const*>(source.GetRawData());
+			PixelBufferPool::GetInstance().RecordCopy(pixel_count);
+			for (int y = 0; y < resolution.y; ++y)
+			{
+				int src_y = y * src_res.y / resolution.y;
+				for (int x = 0; x < resolution.x; ++x)
+				{
+					int src_x = x * src_res.x / resolution.x;
+					packed[(y * resolution.x + x) * 4 + channel] = src[(src_y * src_res.x + src_x) * 4];
+				}
+			}
+		}
+
+		m_Textures.emplace_back(std::move(packed_image));
+	}
+}
@@ -1,26 +1,61 @@
 #pragma once
 
 #include "image.h"
+#include "imageLoader.h"
 
 namespace VK_Renderer
 {
+	// Channel of the packed scalar layer a scalar map is written to,
+	// also defined in mesh_ltc.frag
+	enum class ScalarChannel : uint8_t
+	{
+		Roughness	= 0,
+		Metallic	= 1,
+		AO			= 2,
+	};
+
+	struct ScalarMapInfo
+	{
+		std::string path;
+		ScalarChannel channel{ ScalarChannel::Roughness };
+		uint8_t defaultValue{ 0 }; // used when the map is missing
+	};
+
 	struct MaterialInfo
 	{
 		std::vector<std::string> texPath;
+		// scalar maps are merged into the channels of one extra layer
+		std::vector<ScalarMapInfo> scalarMaps;
 	};
 
 	class Material
 	{
 	public:
 		Material(MaterialInfo const& info);
+		// Decode the images in the background, call Wait() before reading the textures
+		Material(MaterialInfo const& info, ImageLoader& loader);
+		Material(Material&& material) = default;
 		~Material();
 
 		void Free();
 		void Load(MaterialInfo const& info);
+		void LoadAsync(MaterialInfo const& info, ImageLoader& loader);
+		void Wait();
+
+		void AddImage(Image&& image);
 
-		void AddImage(Image const&& image);
+		// resolution of the first layer, known from the file header before the pixels are decoded
+		glm::ivec3 GetResolution() const;
 
 	protected:
+		void PackScalarLayer(std::vector<Image> const& sources);
+
+	protected:
+		std::vector<ScalarMapInfo> m_ScalarMaps;
+		std::vector<PendingImage> m_PendingTextures;
+		std::vector<PendingImage> m_PendingScalarMaps;
+
 		DeclareWithGetFunc(protected, std::vector <Image>, m, Textures, const);
+		DeclareWithGetFunc(protected, uint32_t, m, LayerCount, const);
 	};
-}
\ No newline at end of file
+}
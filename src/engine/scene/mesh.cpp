@@ -2,12 +2,45 @@
 
 #include "tiny_obj_loader.h"
 #include <iostream>
+#include <sstream>
 
 #include "material.h"
 #include "image.h"
 
 namespace VK_Renderer
 {
+	// Names of the materials that set Pr in the mtl libraries of an obj. tinyobj reads an absent Pr as 0,
+	// the same as an explicit Pr 0 of a perfectly smooth surface. The libraries precede the first usemtl.
+	static std::unordered_set<std::string> MaterialsWithRoughness(const std::string& objFile)
+	{
+		std::unordered_set<std::string> names;
+		std::filesystem::path const directory = std::filesystem::path(objFile).parent_path();
+		std::ifstream obj(objFile);
+		std::string line, key;
+		while (std::getline(obj, line))
+		{
+			std::istringstream obj_line(line);
+			if (!(obj_line >> key)) continue;
+			if (key == "usemtl") break;
+			if (key != "mtllib") continue;
+
+			std::string library;
+			while (obj_line >> library)
+			{
+				std::ifstream mtl(directory / library);
+				std::string material, mtl_line;
+				while (std::getline(mtl, mtl_line))
+				{
+					std::istringstream values(mtl_line);
+					if (!(values >> key)) continue;
+					if (key == "newmtl") values >> material;
+					else if (key == "Pr") names.insert(material);
+				}
+			}
+		}
+		return names;
+	}
+
 	Mesh::Mesh(const std::string& file)
 		: m_MaterialCounts(0), m_TriangleCounts(0)
 	{
@@ -55,6 +88,7 @@ namespace VK_Renderer
 		auto& materials = reader.GetMaterials();
 		
 		m_MaterialCounts = materials.size();
+		std::unordered_set<std::string> const with_roughness = MaterialsWithRoughness(file);
 
 		m_Positions.resize(attrib.vertices.size());
 		m_Normals.resize(attrib.normals.size());
@@ -93,12 +127,23 @@ namespace VK_Renderer
 		// load materials
 		for (auto const& material : materials)
 		{
-			m_MaterialInfos.push_back(MaterialInfo({
-				material.diffuse_texname,
-				(material.bump_texname.empty() ? material.normal_texname : material.bump_texname),
-				material.roughness_texname,
-				material.metallic_texname,
-			}));
+			// map_Ka is an ambient colour map, occlusion only comes from the non standard map_ao
+			auto ao_map = material.unknown_parameter.find("map_ao");
+			// without a map the scalar Pr/Pm of the material, a rough surface if Pr is not given either
+			auto to_byte = [](float value) { return static_cast<uint8_t>(glm::clamp(value, 0.f, 1.f) * 255.f + 0.5f); };
+			m_MaterialInfos.push_back(MaterialInfo{
+				.texPath = {
+					material.diffuse_texname,
+					(material.bump_texname.empty() ? material.normal_texname : material.bump_texname),
+				},
+				.scalarMaps = {
+					{ .path = material.roughness_texname, .channel = ScalarChannel::Roughness,
+						.defaultValue = (with_roughness.count(material.name) > 0 ? to_byte(material.roughness) : uint8_t(255)) },
+					{ .path = material.metallic_texname, .channel = ScalarChannel::Metallic, .defaultValue = to_byte(material.metallic) },
+					{ .path = (ao_map != material.unknown_parameter.end() ? ao_map->second : std::string()),
+						.channel = ScalarChannel::AO, .defaultValue = 255 },
+				}
+			});
 		}
 	}
 }
\ No newline at end of file
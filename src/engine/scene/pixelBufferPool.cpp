@@ -0,0 +1,155 @@
+#include "pixelBufferPool.h"
+
+namespace VK_Renderer
+{
+	// header in front of every buffer, 16 bytes keeps the pixels aligned for simd loads
+	struct alignas(16) PixelBufferHeader
+	{
+		uint64_t capacity;
+		uint32_t sizeClass;
+		uint32_t pooled;
+	};
+
+	// class c holds 2^(c / steps) * (1 + (c % steps) / steps) bytes
+	static uint64_t ClassCapacity(uint32_t const& sizeClass)
+	{
+		uint64_t base = 1ull << (sizeClass / PixelBufferPool::SizeClassSteps);
+		return base + (sizeClass % PixelBufferPool::SizeClassSteps) * (base / PixelBufferPool::SizeClassSteps);
+	}
+
+	// smallest class that holds size bytes, size is at least MinPooledSize
+	static uint32_t SizeClass(uint64_t const& size)
+	{
+		uint32_t exponent = 0;
+		while ((2ull << exponent) <= size) ++exponent;
+		uint32_t size_class = exponent * PixelBufferPool::SizeClassSteps;
+		while (ClassCapacity(size_class) < size) ++size_class;
+		return size_class;
+	}
+
+	static PixelBufferHeader* GetHeader(void const* buffer)
+	{
+		return reinterpret_cast<PixelBufferHeader*>(const_cast<char*>(reinterpret_cast<char const*>(buffer))) - 1;
+	}
+
+	PixelBufferPool& PixelBufferPool::GetInstance()
+	{
+		static PixelBufferPool s_Instance;
+		return s_Instance;
+	}
+
+	PixelBufferPool::~PixelBufferPool()
+	{
+		Trim();
+	}
+
+	void* PixelBufferPool::Allocate(uint64_t const& size)
+	{
+		bool pooled = (size >= MinPooledSize);
+		uint32_t size_class = (pooled ? SizeClass(size) : 0);
+		uint64_t capacity = (pooled ? ClassCapacity(size_class) : size);
+
+		PixelBufferHeader* header = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			++m_Stats.allocations;
+			m_Stats.bytesInUse += capacity;
+			if (pooled && m_FreeLists[size_class].size() > 0)
+			{
+				header = reinterpret_cast<PixelBufferHeader*>(m_FreeLists[size_class].back());
+				m_FreeLists[size_class].pop_back();
+				m_CachedBytes -= capacity;
+				++m_Stats.poolHits;
+			}
+			else
+			{
+				m_Stats.bytesAllocated += capacity;
+			}
+		}
+
+		if (!header)
+		{
+			header = reinterpret_cast<PixelBufferHeader*>(malloc(sizeof(PixelBufferHeader) + capacity));
+			if (!header) throw std::bad_alloc();
+			header->capacity = capacity;
+			header->sizeClass = size_class;
+			header->pooled = pooled;
+		}
+		return header + 1;
+	}
+
+	void* PixelBufferPool::Reallocate(void* buffer, uint64_t const& size)
+	{
+		if (!buffer) return Allocate(size);
+		uint64_t capacity = GetCapacity(buffer);
+		if (size <= capacity) return buffer;
+
+		void* new_buffer = Allocate(size);
+		Copy(new_buffer, buffer, capacity);
+		Free(buffer);
+		return new_buffer;
+	}
+
+	void PixelBufferPool::Free(void* buffer)
+	{
+		if (!buffer) return;
+		PixelBufferHeader* header = GetHeader(buffer);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stats.bytesInUse -= header->capacity;
+			if (header->pooled && m_CachedBytes + header->capacity <= MaxCachedBytes)
+			{
+				m_FreeLists[header->sizeClass].push_back(header);
+				m_CachedBytes += header->capacity;
+				return;
+			}
+		}
+		free(header);
+	}
+
+	void PixelBufferPool::Copy(void* dst, void const* src, uint64_t const& size)
+	{
+		std::memcpy(dst, src, size);
+		RecordCopy(size);
+	}
+
+	void PixelBufferPool::RecordCopy(uint64_t const& size)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		++m_Stats.copies;
+		m_Stats.bytesCopied += size;
+	}
+
+	void PixelBufferPool::Trim()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (std::vector<void*>& free_list : m_FreeLists)
+		{
+			for (void* header : free_list)
+			{
+				free(header);
+			}
+			free_list.clear();
+		}
+		m_CachedBytes = 0;
+	}
+
+	PixelBufferStats PixelBufferPool::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	void PixelBufferPool::ResetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		uint64_t in_use = m_Stats.bytesInUse;
+		m_Stats = {};
+		m_Stats.bytesInUse = in_use;
+	}
+
+	uint64_t PixelBufferPool::GetCapacity(void const* buffer)
+	{
+		return GetHeader(buffer)->capacity;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mutex>
+
+namespace VK_Renderer
+{
+	struct PixelBufferStats
+	{
+		uint64_t allocations{ 0 };		// buffers handed out
+		uint64_t poolHits{ 0 };			// buffers reused from a free list
+		uint64_t bytesAllocated{ 0 };	// bytes requested from the system
+		uint64_t bytesInUse{ 0 };
+		uint64_t copies{ 0 };			// pixel copies between cpu buffers
+		uint64_t bytesCopied{ 0 };
+	};
+
+	// Size-classed allocator for image pixels, freed buffers are kept per size class and handed
+	// out again. Each power of two is split in SizeClassSteps classes, so a buffer wastes less than
+	// a quarter of its size (48 MB stays 48 MB instead of 64 MB) while a freed buffer still serves
+	// every request of its class. Buffers carry their class in a small header so
+	// they can be freed or grown from the pointer alone (stb_image allocates through it).
+	class PixelBufferPool
+	{
+	public:
+		static PixelBufferPool& GetInstance();
+
+		void* Allocate(uint64_t const& size);
+		void* Reallocate(void* buffer, uint64_t const& size);
+		void Free(void* buffer);
+
+		// Copy pixels between cpu buffers and record it, redundant copies show up in the stats
+		void Copy(void* dst, void const* src, uint64_t const& size);
+		// Record pixels copied in place by the caller, for strided or resampled copies
+		void RecordCopy(uint64_t const& size);
+
+		// Return cached buffers to the system
+		void Trim();
+
+		PixelBufferStats GetStats();
+		void ResetStats();
+
+		static uint64_t GetCapacity(void const* buffer);
+
+	protected:
+		PixelBufferPool() = default;
+		~PixelBufferPool();
+
+	public:
+		// requests below this size go straight to malloc
+		static constexpr uint64_t MinPooledSize = 64 * 1024;
+		// cached bytes above this are released to the system
+		static constexpr uint64_t MaxCachedBytes = 512ull << 20;
+		// size classes per power of two
+		static constexpr uint32_t SizeClassSteps = 4;
+
+	protected:
+		std::mutex m_Mutex;
+		std::array<std::vector<void*>, 64 * SizeClassSteps> m_FreeLists;
+		uint64_t m_CachedBytes{ 0 };
+		PixelBufferStats m_Stats;
+	};
+}
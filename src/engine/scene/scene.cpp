@@ -199,17 +199,78 @@ Improved: {}%
 	}
 	void Scene::ComputeAtlasTexture()
 	{
-		// Load textures
-		std::vector<Material> materails;
+		m_AtlasTex2D.reset();
+		m_AtlasTex2D = mkU<AtlasTexture2D>();
+		AtlasTexture2D* atlas = m_AtlasTex2D.get();
 
+		// compute atlas layout from the file headers, no pixel is decoded yet
+		// the block takes the largest map of the material, smaller ones are resampled into it.
+		// Maps the atlas can't hold are left out and their layer or channel keeps its default.
+		std::unordered_set<std::string> skipped_paths;
+		auto read_resolution = [atlas, &skipped_paths](std::string const& path, glm::ivec2& resolution) {
+			if (path.size() == 0) return;
+			ImageInfo image_info;
+			if (!Image::ReadInfo(path, image_info) || !atlas->AcceptsFormat(image_info.format))
+			{
+				std::cerr << "Atlas: skipped " << path << ", unreadable or not 8 bit RGBA" << std::endl;
+				skipped_paths.insert(path);
+				return;
+			}
+			glm::ivec2 dim(image_info.resolution);
+			if (dim.x * dim.y > resolution.x * resolution.y) resolution = dim;
+		};
+		std::vector<glm::ivec2> resolutions;
 		for (auto const& info : m_MaterialInfos)
 		{
-			materails.push_back(Material(info));
+			glm::ivec2 resolution(0);
+			for (std::string const& path : info.texPath) read_resolution(path, resolution);
+			for (ScalarMapInfo const& map : info.scalarMaps) read_resolution(map.path, resolution);
+			resolutions.emplace_back(resolution);
 		}
+		uint32_t layer_count = 0;
+		if (m_MaterialInfos.size() > 0)
+		{
+			layer_count = m_MaterialInfos[0].texPath.size() + (m_MaterialInfos[0].scalarMaps.size() > 0 ? 1 : 0);
+		}
+		atlas->ComputeLayout(resolutions, layer_count);
 
-		// compute atlas texture
-		m_AtlasTex2D.reset();
-		m_AtlasTex2D = mkU<AtlasTexture2D>(materails);
+		// decode in the background and stream pixels straight into their blocks,
+		// only the images within the loader budget are alive at the same time
+		ImageLoader loader;
+		std::vector<std::future<void>> uploads;
+		// the header may not tell the decoded format, the copies check it again
+		auto report = [](std::string const& path, bool const& copied) {
+			if (!copied) std::cerr << "Atlas: " << path << " decoded to a format the atlas can't hold" << std::endl;
+		};
+		for (uint32_t i = 0; i < m_MaterialInfos.size(); ++i)
+		{
+			MaterialInfo const& info = m_MaterialInfos[i];
+			for (uint32_t k = 0; k < info.texPath.size(); ++k)
+			{
+				std::string const& path = info.texPath[k];
+				if (path.size() == 0 || skipped_paths.count(path) > 0) continue;
+				uploads.push_back(loader.Stream(path, [atlas, i, k, path, report](Image const& image) {
+					report(path, atlas->CopyImage(i, k, image));
+				}));
+			}
+
+			if (info.scalarMaps.size() == 0) continue;
+			uint32_t scalar_layer = info.texPath.size();
+			atlas->FillChannel(i, scalar_layer, 3, 255);
+			for (ScalarMapInfo const& map : info.scalarMaps)
+			{
+				uint8_t channel = static_cast<uint8_t>(map.channel);
+				atlas->FillChannel(i, scalar_layer, channel, map.defaultValue);
+				if (map.path.size() == 0 || skipped_paths.count(map.path) > 0) continue;
+				uploads.push_back(loader.Stream(map.path, [atlas, i, scalar_layer, channel, path = map.path, report](Image const& image) {
+					report(path, atlas->CopyChannel(i, scalar_layer, channel, image));
+				}));
+			}
+		}
+		for (std::future<void>& upload : uploads)
+		{
+			upload.get();
+		}
 		
 		// Recompute uvs
 		for (Vertex& v : m_Meshlets->GetVertices())
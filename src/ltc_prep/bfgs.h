@@ -0,0 +1,145 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+namespace bfgs{
+    // Quasi-Newton (BFGS) solver with central finite difference gradients and a backtracking line search.
+    // Same interface and termination criterion as nelder_mead::NelderMead: meant for smooth objectives
+    // started close to their minimum, e.g. warm started from a neighboring LTC fit. delta is the length of
+    // the first step, later steps come from the inverse Hessian estimate.
+    template<int DIM, typename FUNC>
+    float BFGS(
+        float* pmin, const float* start, float delta, float tolerance, int maxIters, FUNC objectiveFn)
+    {
+        // Armijo condition and step reduction of the line search, near minAlpha the error is steep enough
+        // to need steps many times shorter than delta
+        const float armijo = 1e-4f;
+        const float backtrack = 0.5f;
+        const int maxBacktracks = 30;
+
+        float x[DIM], g[DIM], H[DIM][DIM];
+
+        // relative step of the finite differences, with a floor so parameters near 0 still move
+        auto gradient = [&](const float* p, float* grad)
+        {
+            float q[DIM];
+            for (int i = 0; i < DIM; i++)
+                q[i] = p[i];
+            for (int i = 0; i < DIM; i++)
+            {
+                const float h = 1e-3f * std::max(fabsf(p[i]), 1e-4f);
+                q[i] = p[i] + h;
+                const float fp = objectiveFn(q);
+                q[i] = p[i] - h;
+                const float fm = objectiveFn(q);
+                q[i] = p[i];
+                grad[i] = (fp - fm) / (2.0f * h);
+            }
+        };
+
+        for (int i = 0; i < DIM; i++)
+            x[i] = start[i];
+        float f = objectiveFn(x);
+        gradient(x, g);
+
+        // identity scaled so the first step has length delta
+        float gnorm = 0.0f;
+        for (int i = 0; i < DIM; i++)
+            gnorm += g[i] * g[i];
+        gnorm = sqrtf(gnorm);
+        for (int i = 0; i < DIM; i++)
+            for (int j = 0; j < DIM; j++)
+                H[i][j] = (i == j && gnorm > 0.0f) ? delta / gnorm : 0.0f;
+
+        for (int iter = 0; iter < maxIters; iter++)
+        {
+            // descent direction p = -H g, back to steepest descent if H lost positive definiteness
+            float p[DIM];
+            float slope = 0.0f;
+            for (int i = 0; i < DIM; i++)
+            {
+                p[i] = 0.0f;
+                for (int j = 0; j < DIM; j++)
+                    p[i] -= H[i][j] * g[j];
+                slope += p[i] * g[i];
+            }
+            if (slope >= 0.0f)
+            {
+                gnorm = 0.0f;
+                for (int i = 0; i < DIM; i++)
+                    gnorm += g[i] * g[i];
+                gnorm = sqrtf(gnorm);
+                if (gnorm == 0.0f)
+                    break;
+                slope = 0.0f;
+                for (int i = 0; i < DIM; i++)
+                {
+                    for (int j = 0; j < DIM; j++)
+                        H[i][j] = (i == j) ? delta / gnorm : 0.0f;
+                    p[i] = -delta / gnorm * g[i];
+                    slope += p[i] * g[i];
+                }
+            }
+
+            // backtracking line search
+            float t = 1.0f, xn[DIM], fn = f;
+            bool accepted = false;
+            for (int k = 0; k < maxBacktracks; k++, t *= backtrack)
+            {
+                for (int i = 0; i < DIM; i++)
+                    xn[i] = x[i] + t * p[i];
+                fn = objectiveFn(xn);
+                if (fn <= f + armijo * t * slope)
+                {
+                    accepted = true;
+                    break;
+                }
+            }
+            if (!accepted)
+                break;
+
+            // stop on the relative decrease, as NelderMead does on the spread of the simplex
+            const bool converged = 2.0f * fabsf(f - fn) < (fabsf(f) + fabsf(fn)) * tolerance;
+
+            float gn[DIM], s[DIM], y[DIM];
+            for (int i = 0; i < DIM; i++)
+            {
+                s[i] = xn[i] - x[i];
+                x[i] = xn[i];
+            }
+            f = fn;
+            if (converged)
+                break;
+            gradient(x, gn);
+            float sy = 0.0f;
+            for (int i = 0; i < DIM; i++)
+            {
+                y[i] = gn[i] - g[i];
+                g[i] = gn[i];
+                sy += s[i] * y[i];
+            }
+
+            // H = (I - rho s y^T) H (I - rho y s^T) + rho s s^T, skipped without curvature along s
+            if (sy > 1e-12f)
+            {
+                const float rho = 1.0f / sy;
+                float Hy[DIM];
+                float yHy = 0.0f;
+                for (int i = 0; i < DIM; i++)
+                {
+                    Hy[i] = 0.0f;
+                    for (int j = 0; j < DIM; j++)
+                        Hy[i] += H[i][j] * y[j];
+                    yHy += y[i] * Hy[i];
+                }
+                for (int i = 0; i < DIM; i++)
+                    for (int j = 0; j < DIM; j++)
+                        H[i][j] += rho * ((1.0f + rho * yHy) * s[i] * s[j] - Hy[i] * s[j] - s[i] * Hy[j]);
+            }
+        }
+
+        // return best point and its value
+        for (int i = 0; i < DIM; i++)
+            pmin[i] = x[i];
+        return f;
+    }
+}
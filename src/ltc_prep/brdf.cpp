@@ -1,6 +1,17 @@
 #include "brdf.h"
+#include "ltc_simd.h"
 
-float BRDF::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const
+static constexpr float PI = 3.14159f;
+
+void BRDF::Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const
+{
+    for (int i = 0; i < L.PaddedCount(); ++i)
+        eval[i] = Eval(V, L.Get(i), alpha, pdf[i]);
+}
+
+// GGX with the Smith G2 either height-correlated or separable (G1(V) * G1(L))
+template<bool Separable>
+static float EvalGGX(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf)
 {
     if (V.z <= 0)
     {
@@ -23,7 +34,7 @@ float BRDF::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, floa
     else
     {
         const float LambdaL = lambda(alpha, L.z);
-        G2 = 1.0f / (1.0f + LambdaV + LambdaL);
+        G2 = Separable ? 1.0f / ((1.0f + LambdaV) * (1.0f + LambdaL)) : 1.0f / (1.0f + LambdaV + LambdaL);
     }
 
     // D
@@ -40,7 +51,7 @@ float BRDF::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, floa
     return res;
 }
 
-glm::vec3 BRDF::Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const
+static glm::vec3 SampleGGX(const glm::vec3& V, const float alpha, const float U1, const float U2)
 {
     const float phi = 2.0f * 3.14159f * U1;
     const float r = alpha * sqrtf(U2 / (1.0f - U2));
@@ -48,3 +59,270 @@ glm::vec3 BRDF::Sample(const glm::vec3& V, const float alpha, const float U1, co
     const glm::vec3 L = -V + 2.0f * N * glm::dot(N, V);
     return L;
 }
+
+template<bool Separable>
+static void EvalGGX(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf)
+{
+    using namespace ltc_simd;
+    const int count = L.PaddedCount();
+    if (V.z <= 0)
+    {
+        std::fill(eval, eval + count, 0.f);
+        std::fill(pdf, pdf + count, 0.f);
+        return;
+    }
+
+    // tan(acos(c))^2 = (1 - c^2) / c^2, the scalar lambda without acosf and tanf
+    const float alpha2 = alpha * alpha;
+    auto lambda = [alpha2](const Lanes _cosTheta) {
+        const Lanes cos2 = Mul(_cosTheta, _cosTheta);
+        const Lanes tan2 = Max(Div(Sub(Set(1.0f), cos2), cos2), Set(0.0f));
+        return Mul(Set(0.5f), Sub(Sqrt(Add(Set(1.0f), Mul(Set(alpha2), tan2))), Set(1.0f)));
+    };
+    const float tan2V = std::max((1.0f - V.z * V.z) / (V.z * V.z), 0.0f);
+    const float LambdaV = 0.5f * (-1.0f + sqrtf(1.0f + alpha2 * tan2V));
+
+    for (int i = 0; i < count; i += Width)
+    {
+        const Lanes lx = Load(&L.x[i]), ly = Load(&L.y[i]), lz = Load(&L.z[i]);
+
+        // shadowing, 0 below the horizon
+        const Lanes G2 = SelectPositive(lz, Separable ?
+            Div(Set(1.0f), Mul(Set(1.0f + LambdaV), Add(Set(1.0f), lambda(lz)))) :
+            Div(Set(1.0f), Add(Set(1.0f + LambdaV), lambda(lz))));
+
+        // D
+        Lanes hx = Add(lx, Set(V.x)), hy = Add(ly, Set(V.y)), hz = Add(lz, Set(V.z));
+        const Lanes inv_len = Div(Set(1.0f), Sqrt(Add(Add(Mul(hx, hx), Mul(hy, hy)), Mul(hz, hz))));
+        hx = Mul(hx, inv_len);
+        hy = Mul(hy, inv_len);
+        hz = Mul(hz, inv_len);
+        const Lanes hz2 = Mul(hz, hz);
+        const Lanes slope2 = Div(Add(Mul(hx, hx), Mul(hy, hy)), hz2);
+        Lanes D = Div(Set(1.0f), Add(Set(1.0f), Div(slope2, Set(alpha2))));
+        D = Mul(D, D);
+        D = Div(D, Mul(Set(3.14159f * alpha2), Mul(hz2, hz2)));
+
+        const Lanes VdotH = Add(Add(Mul(Set(V.x), hx), Mul(Set(V.y), hy)), Mul(Set(V.z), hz));
+        Store(pdf + i, Abs(Div(Mul(D, hz), Mul(Set(4.0f), VdotH))));
+        Store(eval + i, Div(Mul(D, G2), Set(4.0f * V.z)));
+    }
+}
+
+void BRDF::Sample(const glm::vec3& V, const float alpha, const float* U1, const float* U2, const int count, SampleBatch& L) const
+{
+    L.Resize(count);
+    for (int i = 0; i < count; ++i)
+        L.Set(i, Sample(V, alpha, U1[i], U2[i]));
+    L.Pad();
+}
+
+float BRDFGGX::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const
+{
+    return EvalGGX<false>(V, L, alpha, pdf);
+}
+
+glm::vec3 BRDFGGX::Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const
+{
+    return SampleGGX(V, alpha, U1, U2);
+}
+
+void BRDFGGX::Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const
+{
+    EvalGGX<false>(V, L, alpha, eval, pdf);
+}
+
+float BRDFGGXSeparable::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const
+{
+    return EvalGGX<true>(V, L, alpha, pdf);
+}
+
+glm::vec3 BRDFGGXSeparable::Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const
+{
+    return SampleGGX(V, alpha, U1, U2);
+}
+
+void BRDFGGXSeparable::Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const
+{
+    EvalGGX<true>(V, L, alpha, eval, pdf);
+}
+
+float BRDFDisneyDiffuse::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const
+{
+    if (V.z <= 0 || L.z <= 0)
+    {
+        pdf = 0;
+        return 0;
+    }
+
+    // Burley 2012, retro-reflection at grazing angles grows with the roughness
+    const float roughness = sqrtf(alpha);
+    const glm::vec3 H = glm::normalize(V + L);
+    const float LdotH = glm::dot(L, H);
+    const float FD90 = 0.5f + 2.0f * roughness * LdotH * LdotH;
+    auto schlick = [](const float _cosTheta) {
+        const float m = 1.0f - _cosTheta;
+        return m * m * m * m * m;
+    };
+    const float FL = 1.0f + (FD90 - 1.0f) * schlick(L.z);
+    const float FV = 1.0f + (FD90 - 1.0f) * schlick(V.z);
+
+    pdf = L.z / PI;
+    return FL * FV / PI * L.z;
+}
+
+glm::vec3 BRDFDisneyDiffuse::Sample(const glm::vec3& /*V*/, const float /*alpha*/, const float U1, const float U2) const
+{
+    const float theta = acosf(sqrtf(U1));
+    const float phi = 2.0f * PI * U2;
+    return glm::vec3(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta));
+}
+
+void BRDFDisneyDiffuse::Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const
+{
+    using namespace ltc_simd;
+    const int count = L.PaddedCount();
+    if (V.z <= 0)
+    {
+        std::fill(eval, eval + count, 0.f);
+        std::fill(pdf, pdf + count, 0.f);
+        return;
+    }
+
+    const float roughness = sqrtf(alpha);
+    const float mV = 1.0f - V.z;
+    const float schlickV = mV * mV * mV * mV * mV;
+    for (int i = 0; i < count; i += Width)
+    {
+        const Lanes lx = Load(&L.x[i]), ly = Load(&L.y[i]), lz = Load(&L.z[i]);
+        const Lanes hx = Add(lx, Set(V.x)), hy = Add(ly, Set(V.y)), hz = Add(lz, Set(V.z));
+        // dot(L, H)^2 with H = (V + L) / |V + L|
+        const Lanes LdotH = Add(Add(Mul(lx, hx), Mul(ly, hy)), Mul(lz, hz));
+        const Lanes LdotH2 = Div(Mul(LdotH, LdotH), Add(Add(Mul(hx, hx), Mul(hy, hy)), Mul(hz, hz)));
+        const Lanes FD90_1 = Add(Set(-0.5f), Mul(Set(2.0f * roughness), LdotH2));
+
+        const Lanes mL = Sub(Set(1.0f), lz);
+        const Lanes mL2 = Mul(mL, mL);
+        const Lanes FL = Add(Set(1.0f), Mul(FD90_1, Mul(Mul(mL2, mL2), mL)));
+        const Lanes FV = Add(Set(1.0f), Mul(FD90_1, Set(schlickV)));
+
+        const Lanes cosL = SelectPositive(lz, lz);
+        Store(pdf + i, Mul(cosL, Set(1.0f / PI)));
+        Store(eval + i, Mul(Mul(FL, FV), Mul(cosL, Set(1.0f / PI))));
+    }
+}
+
+float BRDFSheen::Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const
+{
+    if (V.z <= 0 || L.z <= 0)
+    {
+        pdf = 0;
+        return 0;
+    }
+
+    // Charlie distribution (Estevez and Kulla 2017), D = (2 + 1 / alpha) sin(theta_h)^(1 / alpha) / (2 pi)
+    const glm::vec3 H = glm::normalize(V + L);
+    const float sin2 = std::max(1.0f - H.z * H.z, 0.0f);
+    // below this the lobe underflows to 0 everywhere and the fitted amplitude with it
+    const float inv_alpha = 1.0f / std::max(alpha, 0.05f);
+    const float D = (2.0f + inv_alpha) * powf(sin2, 0.5f * inv_alpha) / (2.0f * PI);
+    // Ashikhmin visibility
+    const float Vis = 1.0f / (4.0f * (L.z + V.z - L.z * V.z));
+
+    pdf = 1.0f / (2.0f * PI);
+    return D * Vis * L.z;
+}
+
+glm::vec3 BRDFSheen::Sample(const glm::vec3& /*V*/, const float /*alpha*/, const float U1, const float U2) const
+{
+    const float z = U1;
+    const float r = sqrtf(std::max(1.0f - z * z, 0.0f));
+    const float phi = 2.0f * PI * U2;
+    return glm::vec3(r * cosf(phi), r * sinf(phi), z);
+}
+
+float BRDFGGXAnisotropic::Eval(const glm::vec3& V, const glm::vec3& L, const float /*alpha*/, float& pdf) const
+{
+    if (V.z <= 0)
+    {
+        pdf = 0;
+        return 0;
+    }
+
+    // alpha(phi)^2 * tan(theta)^2 of the direction
+    auto lambda = [this](const glm::vec3& _dir) {
+        const float a2tan2 = (_dir.x * _dir.x * alphaX * alphaX + _dir.y * _dir.y * alphaY * alphaY) / (_dir.z * _dir.z);
+        return 0.5f * (-1.0f + sqrtf(1.0f + a2tan2));
+    };
+    const float G2 = L.z <= 0.0f ? 0.0f : 1.0f / (1.0f + lambda(V) + lambda(L));
+
+    const glm::vec3 H = glm::normalize(V + L);
+    const float slopex = H.x / H.z / alphaX;
+    const float slopey = H.y / H.z / alphaY;
+    float D = 1.0f / (1.0f + slopex * slopex + slopey * slopey);
+    D = D * D;
+    D = D / (PI * alphaX * alphaY * H.z * H.z * H.z * H.z);
+
+    pdf = fabsf(D * H.z / 4.0f / glm::dot(V, H));
+    return D * G2 / 4.0f / V.z;
+}
+
+glm::vec3 BRDFGGXAnisotropic::Sample(const glm::vec3& V, const float /*alpha*/, const float U1, const float U2) const
+{
+    const float phi = 2.0f * PI * U1;
+    const float r = sqrtf(U2 / (1.0f - U2));
+    const glm::vec3 N = glm::normalize(glm::vec3(alphaX * r * cosf(phi), alphaY * r * sinf(phi), 1.0f));
+    return -V + 2.0f * N * glm::dot(N, V);
+}
+
+void BRDFGGXAnisotropic::Eval(const glm::vec3& V, const SampleBatch& L, const float /*alpha*/, float* eval, float* pdf) const
+{
+    using namespace ltc_simd;
+    const int count = L.PaddedCount();
+    if (V.z <= 0)
+    {
+        std::fill(eval, eval + count, 0.f);
+        std::fill(pdf, pdf + count, 0.f);
+        return;
+    }
+
+    const float alphaX2 = alphaX * alphaX, alphaY2 = alphaY * alphaY;
+    const float LambdaV = 0.5f * (-1.0f + sqrtf(1.0f + (V.x * V.x * alphaX2 + V.y * V.y * alphaY2) / (V.z * V.z)));
+
+    for (int i = 0; i < count; i += Width)
+    {
+        const Lanes lx = Load(&L.x[i]), ly = Load(&L.y[i]), lz = Load(&L.z[i]);
+
+        // shadowing, 0 below the horizon
+        const Lanes a2tan2 = Div(Add(Mul(Mul(lx, lx), Set(alphaX2)), Mul(Mul(ly, ly), Set(alphaY2))), Mul(lz, lz));
+        const Lanes LambdaL = Mul(Set(0.5f), Sub(Sqrt(Add(Set(1.0f), a2tan2)), Set(1.0f)));
+        const Lanes G2 = SelectPositive(lz, Div(Set(1.0f), Add(Set(1.0f + LambdaV), LambdaL)));
+
+        // D
+        Lanes hx = Add(lx, Set(V.x)), hy = Add(ly, Set(V.y)), hz = Add(lz, Set(V.z));
+        const Lanes inv_len = Div(Set(1.0f), Sqrt(Add(Add(Mul(hx, hx), Mul(hy, hy)), Mul(hz, hz))));
+        hx = Mul(hx, inv_len);
+        hy = Mul(hy, inv_len);
+        hz = Mul(hz, inv_len);
+        const Lanes hz2 = Mul(hz, hz);
+        const Lanes slope2 = Div(Add(Div(Mul(hx, hx), Set(alphaX2)), Div(Mul(hy, hy), Set(alphaY2))), hz2);
+        Lanes D = Div(Set(1.0f), Add(Set(1.0f), slope2));
+        D = Mul(D, D);
+        D = Div(D, Mul(Set(PI * alphaX * alphaY), Mul(hz2, hz2)));
+
+        const Lanes VdotH = Add(Add(Mul(Set(V.x), hx), Mul(Set(V.y), hy)), Mul(Set(V.z), hz));
+        Store(pdf + i, Abs(Div(Mul(D, hz), Mul(Set(4.0f), VdotH))));
+        Store(eval + i, Div(Mul(D, G2), Set(4.0f * V.z)));
+    }
+}
+
+std::unique_ptr<BRDF> CreateBRDF(const BRDFModel model)
+{
+    switch (model)
+    {
+    case BRDFModel::GGXSeparable: return std::make_unique<BRDFGGXSeparable>();
+    case BRDFModel::DisneyDiffuse: return std::make_unique<BRDFDisneyDiffuse>();
+    case BRDFModel::Sheen: return std::make_unique<BRDFSheen>();
+    default: return std::make_unique<BRDFGGX>();
+    }
+}
@@ -1,8 +1,76 @@
 #pragma once
 #include <glm.hpp>
+#include <memory>
+#include "sample_batch.h"
 
+// BRDFs the LTC tables can be fitted to, in the order of their layers in the table
+enum class BRDFModel {
+	GGX,			// GGX with the height-correlated Smith G2
+	GGXSeparable,	// GGX with G2 = G1(V) * G1(L)
+	DisneyDiffuse,	// Burley diffuse, roughness = sqrt(alpha)
+	Sheen			// Charlie sheen with the Ashikhmin visibility
+};
+
+// Eval returns BRDF * cos(theta_L) and the pdf of Sample for L
 class BRDF {
 public:
-	virtual float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const;
-	virtual glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const;
-};
\ No newline at end of file
+	virtual ~BRDF() = default;
+	virtual float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const = 0;
+	virtual glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const = 0;
+	// Batched versions, eval and pdf hold L.PaddedCount() values. The defaults loop over the scalar ones.
+	virtual void Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const;
+	// one direction per (U1[i], U2[i]), i < count
+	virtual void Sample(const glm::vec3& V, const float alpha, const float* U1, const float* U2, const int count, SampleBatch& L) const;
+};
+
+// The models are final so a fit specialized on one of them calls it without virtual dispatch
+class BRDFGGX final : public BRDF {
+public:
+	float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const override;
+	glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const override;
+	void Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const override;
+	using BRDF::Sample;
+};
+
+class BRDFGGXSeparable final : public BRDF {
+public:
+	float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const override;
+	glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const override;
+	void Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const override;
+	using BRDF::Sample;
+};
+
+class BRDFDisneyDiffuse final : public BRDF {
+public:
+	float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const override;
+	// cosine distributed, independent of V and alpha
+	glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const override;
+	void Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const override;
+	using BRDF::Sample;
+};
+
+class BRDFSheen final : public BRDF {
+public:
+	// the batched Eval is the scalar loop, the sin(theta_h)^(1 / alpha) term has no SIMD version here
+	float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const override;
+	// uniform over the hemisphere, the lobe is too wide for the GGX sampling to help
+	glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const override;
+	using BRDF::Eval;
+	using BRDF::Sample;
+};
+
+// GGX with the height-correlated Smith G2 and a roughness per axis, for the 4D anisotropic table.
+// The roughness is set at construction, the alpha of Eval and Sample is ignored.
+class BRDFGGXAnisotropic final : public BRDF {
+public:
+	float alphaX, alphaY;
+	BRDFGGXAnisotropic(const float _alphaX, const float _alphaY) :alphaX(_alphaX), alphaY(_alphaY) {};
+	float Eval(const glm::vec3& V, const glm::vec3& L, const float alpha, float& pdf) const override;
+	// stretched GGX slopes, the isotropic sampling with alpha = 1 scaled by (alphaX, alphaY)
+	glm::vec3 Sample(const glm::vec3& V, const float alpha, const float U1, const float U2) const override;
+	void Eval(const glm::vec3& V, const SampleBatch& L, const float alpha, float* eval, float* pdf) const override;
+	using BRDF::Sample;
+};
+
+// The model behind a layer when the type is only known at run time, e.g. to validate a table
+std::unique_ptr<BRDF> CreateBRDF(const BRDFModel model);
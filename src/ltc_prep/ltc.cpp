@@ -1,4 +1,5 @@
 #include "ltc.h"
+#include "ltc_simd.h"
 static constexpr float PI = 3.14159f;
 void LTC::Update()
 {
@@ -33,3 +34,45 @@ glm::vec3 LTC::Sample(const float u1, const float u2) const
 	    )
 	);
 }
+
+void LTC::Eval(const SampleBatch& L, float* res) const
+{
+    using namespace ltc_simd;
+    // same steps as the scalar Eval, amplitude * D / jacobian with jacobian = detM / l^3
+    const float scale = m_amplitude / PI / detM;
+    for (int i = 0; i < L.PaddedCount(); i += Width)
+    {
+        const Lanes lx = Load(&L.x[i]), ly = Load(&L.y[i]), lz = Load(&L.z[i]);
+        Lanes ox = Add(Add(Mul(Set(invM[0][0]), lx), Mul(Set(invM[1][0]), ly)), Mul(Set(invM[2][0]), lz));
+        Lanes oy = Add(Add(Mul(Set(invM[0][1]), lx), Mul(Set(invM[1][1]), ly)), Mul(Set(invM[2][1]), lz));
+        Lanes oz = Add(Add(Mul(Set(invM[0][2]), lx), Mul(Set(invM[1][2]), ly)), Mul(Set(invM[2][2]), lz));
+        const Lanes inv_len = Div(Set(1.f), Sqrt(Add(Add(Mul(ox, ox), Mul(oy, oy)), Mul(oz, oz))));
+        ox = Mul(ox, inv_len);
+        oy = Mul(oy, inv_len);
+        oz = Mul(oz, inv_len);
+
+        const Lanes mx = Add(Add(Mul(Set(M[0][0]), ox), Mul(Set(M[1][0]), oy)), Mul(Set(M[2][0]), oz));
+        const Lanes my = Add(Add(Mul(Set(M[0][1]), ox), Mul(Set(M[1][1]), oy)), Mul(Set(M[2][1]), oz));
+        const Lanes mz = Add(Add(Mul(Set(M[0][2]), ox), Mul(Set(M[1][2]), oy)), Mul(Set(M[2][2]), oz));
+        const Lanes l = Sqrt(Add(Add(Mul(mx, mx), Mul(my, my)), Mul(mz, mz)));
+
+        Store(res + i, Mul(Mul(Set(scale), Max(oz, Set(0.f))), Mul(Mul(l, l), l)));
+    }
+}
+
+void LTC::Sample(const SampleBatch& cosineDirections, SampleBatch& L) const
+{
+    using namespace ltc_simd;
+    L.Resize(cosineDirections.count);
+    for (int i = 0; i < L.PaddedCount(); i += Width)
+    {
+        const Lanes dx = Load(&cosineDirections.x[i]), dy = Load(&cosineDirections.y[i]), dz = Load(&cosineDirections.z[i]);
+        const Lanes x = Add(Add(Mul(Set(M[0][0]), dx), Mul(Set(M[1][0]), dy)), Mul(Set(M[2][0]), dz));
+        const Lanes y = Add(Add(Mul(Set(M[0][1]), dx), Mul(Set(M[1][1]), dy)), Mul(Set(M[2][1]), dz));
+        const Lanes z = Add(Add(Mul(Set(M[0][2]), dx), Mul(Set(M[1][2]), dy)), Mul(Set(M[2][2]), dz));
+        const Lanes inv_len = Div(Set(1.f), Sqrt(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z))));
+        Store(&L.x[i], Mul(x, inv_len));
+        Store(&L.y[i], Mul(y, inv_len));
+        Store(&L.z[i], Mul(z, inv_len));
+    }
+}
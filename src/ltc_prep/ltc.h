@@ -2,6 +2,7 @@
 
 #include <glm.hpp>
 #include <iostream>
+#include "sample_batch.h"
 
 struct LTC {
     float m_amplitude;//don't know what's for
@@ -22,4 +23,8 @@ struct LTC {
     void Update();
     float Eval(const glm::vec3& L) const;
     glm::vec3 Sample(const float u1, const float u2) const;
+    // Batched versions, res holds L.PaddedCount() values
+    void Eval(const SampleBatch& L, float* res) const;
+    // L = normalize(M * d) for the cosine distributed directions d
+    void Sample(const SampleBatch& cosineDirections, SampleBatch& L) const;
 };
\ No newline at end of file
@@ -2,51 +2,151 @@
 #define DEBUG 0
 #include "ltc_fit.h"
 #include "nelder_mead.h"//ֱӷŵltc_fit.h ôcppһnelder_mead.h include ltc_fit.hmainҲһ
+#include "bfgs.h"
 #include <iostream>
+#include <cassert>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
 #include <stb_image_write.h>
 #include <dds.h>
-// size of precomputed table (theta, alpha)
-const int N = 64;
-// number of samples used to compute the error during fitting
-const int Nsample = 50;
-// minimal roughness (avoid singularities)
-const float MIN_ALPHA = 0.0001f;
+#include <halfFloat.h>
 namespace LTCFit {
-	void LTCFitter::Update(const float* params)
+	void SetFitParameters(LTC& ltc, const float* params, const bool isotropic, const float minAlpha, const int paramCount)
 	{
-		float m11 = std::max(params[0], MIN_ALPHA);
-		float m22 = std::max(params[1], MIN_ALPHA);
+		float m11 = std::max(params[0], minAlpha);
+		float m22 = std::max(params[1], minAlpha);
 		float m13 = params[2];
-		//float m23 = params[3];
-		if (m_isotropic) {
-			m_ltc.m11 = m11;
-			m_ltc.m22 = m11;
-			m_ltc.m13 = 0.f;
-			m_ltc.m23 = 0.f;
+		float m23 = paramCount > 3 ? params[3] : 0.f;
+		if (isotropic) {
+			ltc.m11 = m11;
+			ltc.m22 = m11;
+			ltc.m13 = 0.f;
+			ltc.m23 = 0.f;
 		}
 		else {
-			m_ltc.m11 = m11;
-			m_ltc.m22 = m22;
-			m_ltc.m13 = m13;
-			//m_ltc.m23 = m23;
+			ltc.m11 = m11;
+			ltc.m22 = m22;
+			ltc.m13 = m13;
+			ltc.m23 = m23;
 		}
-		m_ltc.Update();
+		ltc.Update();
 	}
-	float LTCFitter::operator()(const float* params)
+
+	// (U1, U2) grid of the error, U1 fastest, and the cosine distributed directions the LTC warps for it.
+	// Built once per sample count, every cell and iteration samples the same grid.
+	struct SampleGrid {
+		std::vector<float> U1, U2;
+		SampleBatch cosine;
+		explicit SampleGrid(const int sampleCount) {
+			U1.resize(sampleCount * sampleCount);
+			U2.resize(sampleCount * sampleCount);
+			cosine.Resize(sampleCount * sampleCount);
+			for (int j = 0, n = 0; j < sampleCount; ++j)
+				for (int i = 0; i < sampleCount; ++i, ++n) {
+					U1[n] = (i + 0.5f) / (float)sampleCount;
+					U2[n] = (j + 0.5f) / (float)sampleCount;
+
+					// LTC::Sample with M = identity
+					const float theta = acosf(sqrtf(U1[n]));
+					const float phi = 2 * 3.14159f * U2[n];
+					cosine.Set(n, glm::vec3(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)));
+				}
+			cosine.Pad();
+		}
+	};
+	static const SampleGrid& GetSampleGrid(const int sampleCount)
 	{
-		Update(params);
-		return ComputeError(m_ltc, m_brdf, m_view, m_alpha);
+		static std::mutex mutex;
+		static std::map<int, std::unique_ptr<const SampleGrid>> grids;
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& grid = grids[sampleCount];
+		if (!grid) grid = std::make_unique<const SampleGrid>(sampleCount);
+		return *grid;
+	}
+
+	template<class TBRDF>
+	BRDFSamples::BRDFSamples(const TBRDF& brdf, const glm::vec3& V, const float alpha, const int sampleCount)
+		:grid(&GetSampleGrid(sampleCount))
+	{
+		brdf.Sample(V, alpha, grid->U1.data(), grid->U2.data(), (int)grid->U1.size(), L);
+		eval.resize(L.PaddedCount());
+		pdf.resize(L.PaddedCount());
+		brdf.Eval(V, L, alpha, eval.data(), pdf.data());
+	}
+
+	// Buffers of ComputeError, one set per thread so fitting threads don't allocate per call
+	struct ErrorScratch {
+		SampleBatch L;
+		std::vector<float> eval_brdf, pdf_brdf, eval_ltc;
+	};
+
+	// Sum of the MIS weighted error over the directions of L, eval_brdf and pdf_brdf are the BRDF at L
+	static double AccumulateError(const LTC& ltc, const SampleBatch& L, const float* eval_brdf, const float* pdf_brdf, ErrorScratch& scratch)
+	{
+		scratch.eval_ltc.resize(L.PaddedCount());
+		ltc.Eval(L, scratch.eval_ltc.data());
+
+		double error = 0.0;
+		for (int i = 0; i < L.count; ++i) {
+			float pdf_ltc = scratch.eval_ltc[i] / ltc.m_amplitude;
+			double error_ = fabsf(eval_brdf[i] - scratch.eval_ltc[i]);
+			error_ = error_ * error_ * error_;
+			error += error_ / (pdf_ltc + pdf_brdf[i]);
+		}
+		return error;
 	}
 
+	template<class TBRDF>
+	float ComputeError(const LTC& ltc, const TBRDF& brdf, const BRDFSamples& brdfSamples, const glm::vec3& V, const float alpha)
+	{
+		thread_local ErrorScratch scratch;
+
+		// importance sample LTC, only this half depends on the LTC
+		ltc.Sample(brdfSamples.grid->cosine, scratch.L);
+		scratch.eval_brdf.resize(scratch.L.PaddedCount());
+		scratch.pdf_brdf.resize(scratch.L.PaddedCount());
+		brdf.Eval(V, scratch.L, alpha, scratch.eval_brdf.data(), scratch.pdf_brdf.data());
+		double error = AccumulateError(ltc, scratch.L, scratch.eval_brdf.data(), scratch.pdf_brdf.data(), scratch);
+
+		// importance sample BRDF
+		error += AccumulateError(ltc, brdfSamples.L, brdfSamples.eval.data(), brdfSamples.pdf.data(), scratch);
+
+		return (float)error / (float)brdfSamples.L.count;
+	}
 	float ComputeError(const LTC& ltc, const BRDF& brdf, const glm::vec3& V, const float alpha)
+	{
+		return ComputeError(ltc, brdf, BRDFSamples(brdf, V, alpha), V, alpha);
+	}
+
+	// the base class for callers holding any BRDF, the models for fits specialized on them
+	template BRDFSamples::BRDFSamples(const BRDF&, const glm::vec3&, const float, const int);
+	template BRDFSamples::BRDFSamples(const BRDFGGX&, const glm::vec3&, const float, const int);
+	template BRDFSamples::BRDFSamples(const BRDFGGXSeparable&, const glm::vec3&, const float, const int);
+	template BRDFSamples::BRDFSamples(const BRDFDisneyDiffuse&, const glm::vec3&, const float, const int);
+	template BRDFSamples::BRDFSamples(const BRDFSheen&, const glm::vec3&, const float, const int);
+	template BRDFSamples::BRDFSamples(const BRDFGGXAnisotropic&, const glm::vec3&, const float, const int);
+	template float ComputeError(const LTC&, const BRDF&, const BRDFSamples&, const glm::vec3&, const float);
+	template float ComputeError(const LTC&, const BRDFGGX&, const BRDFSamples&, const glm::vec3&, const float);
+	template float ComputeError(const LTC&, const BRDFGGXSeparable&, const BRDFSamples&, const glm::vec3&, const float);
+	template float ComputeError(const LTC&, const BRDFDisneyDiffuse&, const BRDFSamples&, const glm::vec3&, const float);
+	template float ComputeError(const LTC&, const BRDFSheen&, const BRDFSamples&, const glm::vec3&, const float);
+	template float ComputeError(const LTC&, const BRDFGGXAnisotropic&, const BRDFSamples&, const glm::vec3&, const float);
+	float ComputeErrorReference(const LTC& ltc, const BRDF& brdf, const glm::vec3& V, const float alpha, const int sampleCount)
 	{
 		double error = 0.0;
 
-		for (int j = 0; j < Nsample; ++j)
-			for (int i = 0; i < Nsample; ++i)
+		for (int j = 0; j < sampleCount; ++j)
+			for (int i = 0; i < sampleCount; ++i)
 			{
-				const float U1 = (i + 0.5f) / (float)Nsample;
-				const float U2 = (j + 0.5f) / (float)Nsample;
+				const float U1 = (i + 0.5f) / (float)sampleCount;
+				const float U2 = (j + 0.5f) / (float)sampleCount;
 
 				// importance sample LTC
 				{
@@ -78,47 +178,45 @@ namespace LTCFit {
 					error += error_ / (pdf_ltc + pdf_brdf);
 				}
 			}
-		return (float)error / (float)(Nsample * Nsample);
+		return (float)error / (float)(sampleCount * sampleCount);
 	}
-	void ComputeAverageValues(const BRDF& brdf, const glm::vec3& V, const float alpha, glm::vec3& avg_dir, float& avg_n, float& avg_alpha)
+	void ComputeAverageValues(const BRDFSamples& brdfSamples, const glm::vec3& V, glm::vec3& avg_dir, float& avg_n, float& avg_alpha,
+		const bool keepY)
 	{
 		avg_dir = glm::vec3(0.f);
 		avg_n = 0.f;
 		avg_alpha = 0.f;
 
-		for (int j = 0; j < Nsample; ++j)
-			for (int i = 0; i < Nsample; ++i)
-			{
-				const float U1 = (i + 0.5f) / (float)Nsample;
-				const float U2 = (j + 0.5f) / (float)Nsample;
-
-				// sample
-				const glm::vec3 L = brdf.Sample(V, alpha, U1, U2);
-
-				// eval
-				float pdf;
-				float eval = brdf.Eval(V, L, alpha, pdf);
-
-				// accumulate
-				if (pdf > 0) {
-					float weight = eval / pdf;
-					const glm::vec3 H = glm::normalize(V + L);
-					avg_n += weight;
-					avg_dir += weight * L;
-					avg_alpha += weight * pow(1.f - glm::max(glm::dot(V, H), 0.f), 5.f);// (F0 + (1-F0) * alpha)
-				}
+		for (int n = 0; n < brdfSamples.L.count; ++n)
+		{
+			const glm::vec3 L = brdfSamples.L.Get(n);
+			const float eval = brdfSamples.eval[n];
+			const float pdf = brdfSamples.pdf[n];
+
+			// accumulate
+			if (pdf > 0) {
+				float weight = eval / pdf;
+				const glm::vec3 H = glm::normalize(V + L);
+				avg_n += weight;
+				avg_dir += weight * L;
+				avg_alpha += weight * pow(1.f - glm::max(glm::dot(V, H), 0.f), 5.f);// (F0 + (1-F0) * alpha)
 			}
+		}
 
-		// clear y component, which should be zero with isotropic BRDFs
-		avg_n = avg_n / (float)(Nsample * Nsample);
-		avg_alpha = avg_alpha / (float)(Nsample * Nsample);
-		avg_dir.y = 0.0f;
+		// clear y component, which should be zero with isotropic BRDFs and V in the xz plane
+		avg_n = avg_n / (float)brdfSamples.L.count;
+		avg_alpha = avg_alpha / (float)brdfSamples.L.count;
+		if (!keepY) avg_dir.y = 0.0f;
 		avg_dir = glm::normalize(avg_dir);
 	}
-	void WriteToTextures(const std::string& _filename, const glm::mat3* tab, const glm::vec2* tab_amp, const int N)
+	void ComputeAverageValues(const BRDF& brdf, const glm::vec3& V, const float alpha, glm::vec3& avg_dir, float& avg_n, float& avg_alpha)
+	{
+		ComputeAverageValues(BRDFSamples(brdf, V, alpha), V, avg_dir, avg_n, avg_alpha);
+	}
+	void WriteToTextures(const std::string& _filename, const glm::mat3* tab, const glm::vec2* tab_amp, const int N, const int layerCount, const bool packed)
 	{
-		auto tab_data = new float[4 * N * N];
-		for (int i = 0, n = 0; i < N * N; ++i, n += 4)
+		auto tab_data = new float[4 * N * N * layerCount];
+		for (int i = 0, n = 0; i < N * N * layerCount; ++i, n += 4)
 		{
 			glm::mat3 invM = glm::inverse(tab[i]);
 			invM /= invM[1][1];
@@ -149,120 +247,437 @@ namespace LTCFit {
 
 		std::string filename = _filename + ".dds";
 		std::cout << "write M to texture: " << filename << "..." << std::endl;
-		SaveDDS(filename.c_str(), DDS_FORMAT_R32G32B32A32_FLOAT, sizeof(float) * 4, N, N, tab_data);
+		SaveDDSArray(filename.c_str(), DDS_FORMAT_R32G32B32A32_FLOAT, sizeof(float) * 4, N, N, layerCount, tab_data);
 
 		filename = _filename + "_amp.dds";
 		std::cout << "write amplitude to texture: " << filename << "..." << std::endl;
-		SaveDDS(filename.c_str(), DDS_FORMAT_R32G32_FLOAT, sizeof(float) * 2, N, N, tab_amp);
+		SaveDDSArray(filename.c_str(), DDS_FORMAT_R32G32_FLOAT, sizeof(float) * 2, N, N, layerCount, tab_amp);
+
+		if (packed) {
+			WritePackedTexture(_filename + "_packed.dds", tab_data, &tab_amp[0].x, N, layerCount);
+		}
 
 		delete[] tab_data;
 		
 	}
-	void GenerateTexture(const std::string& baseFilename)
+	// RGBA16F texels of WritePackedTexture, returns the max absolute and relative (over normal halfs) error
+	static std::vector<uint16_t> PackHalf(const float* invM, const float* amp, const int N, const int layerCount, float& maxError,
+		float& maxRelativeError)
 	{
-		BRDF brdf;
-		glm::mat3* tab = new glm::mat3[N * N];
-		glm::vec2* tab_amp = new glm::vec2[N * N];
-		std::cout << "start" << std::endl;
-		LTC ltc;
-		for (int a = N - 1; a >= 0; --a) {
-			for (int t = 0; t <= N - 1; ++t) {
-				float theta = std::min(1.57f, t / (float)(N - 1) * 1.57079f);
-				const glm::vec3 V(sinf(theta), 0.f, cosf(theta));
-
-				float roughness = a / (float)(N - 1);
-				float alpha = std::max(roughness * roughness, MIN_ALPHA);
-#if DEBUG
-				std::cout << "a = " << a << "\t t = " << t << std::endl;
-				std::cout << "alpha = " << alpha << "\t theta = " << theta << std::endl;
-				std::cout << std::endl;
-#endif
-				//ltc.m_amplitude = ComputeNorm(brdf, V, alpha);
-				glm::vec3 avg_dir;
-				ComputeAverageValues(brdf, V, alpha, avg_dir, ltc.m_amplitude, ltc.m_fresnel);
-				bool isotropic;
-
-				if (t == 0) {
-					ltc.X = glm::vec3(1, 0, 0);
-					ltc.Y = glm::vec3(0, 1, 0);
-					ltc.Z = glm::vec3(0, 0, 1);
-
-					if (a == N - 1) {
-						ltc.m11 = 1.f;
-						ltc.m22 = 1.f;
-					}
-					else {
-						ltc.m11 = std::max(tab[a + 1 + t * N][0][0], MIN_ALPHA);
-						ltc.m22 = std::max(tab[a + 1 + t * N][1][1], MIN_ALPHA);
-					}
+		std::vector<uint16_t> packed_data(4 * N * N * 2 * layerCount, 0);
+		maxError = 0.f;
+		maxRelativeError = 0.f;
+		auto pack = [&](const float value, uint16_t& half) {
+			half = VK_Renderer::FloatToHalf(value);
+			const float error = fabsf(VK_Renderer::HalfToFloat(half) - value);
+			maxError = std::max(maxError, error);
+			// below the smallest normal half only the absolute error is meaningful, tiny fresnel terms flush to 0
+			if (fabsf(value) >= 6.103515625e-05f) maxRelativeError = std::max(maxRelativeError, error / fabsf(value));
+		};
+		for (int layer = 0; layer < layerCount; ++layer) {
+			uint16_t* matrix_layer = &packed_data[4 * N * N * (2 * layer)];
+			uint16_t* amp_layer = &packed_data[4 * N * N * (2 * layer + 1)];
+			for (int i = 0; i < N * N; ++i) {
+				for (int c = 0; c < 4; ++c) pack(invM[4 * (layer * N * N + i) + c], matrix_layer[4 * i + c]);
+				for (int c = 0; c < 2; ++c) pack(amp[2 * (layer * N * N + i) + c], amp_layer[4 * i + c]);
+			}
+		}
+		return packed_data;
+	}
+	bool WritePackedTexture(const std::string& filename, const float* invM, const float* amp, const int N, const int layerCount)
+	{
+		float max_abs_error, max_rel_error;
+		std::vector<uint16_t> packed_data = PackHalf(invM, amp, N, layerCount, max_abs_error, max_rel_error);
 
-					ltc.m13 = 0;
-					ltc.m23 = 0;
-					ltc.Update();
-					isotropic = true;
-				}
-				else {
-					glm::vec3 L = glm::normalize(avg_dir);
-					glm::vec3 T1(L.z, 0, -L.x);
-					glm::vec3 T2(0, 1, 0);
-					//fit faster???
-					ltc.X = T1;
-					ltc.Y = T2;
-					ltc.Z = L;
-
-					ltc.Update();
-					isotropic = false;
-				}
+		std::cout << "write packed M and amplitude to texture: " << filename << " (max error " << max_abs_error
+			<< ", max relative error " << max_rel_error << ")..." << std::endl;
+		return SaveDDSArray(filename.c_str(), DDS_FORMAT_R16G16B16A16_FLOAT, sizeof(uint16_t) * 4, N, N, 2 * layerCount, packed_data.data());
+	}
+	// baseFilename.dds and baseFilename_amp.dds as written by WriteToTextures
+	static bool LoadTables(const std::string& baseFilename, DDSImage& matrices, DDSImage& amplitudes)
+	{
+		matrices = LoadDDS((baseFilename + ".dds").c_str());
+		amplitudes = LoadDDS((baseFilename + "_amp.dds").c_str());
+		if (matrices.format != VK_FORMAT_R32G32B32A32_SFLOAT || amplitudes.format != VK_FORMAT_R32G32_SFLOAT
+			|| matrices.width != matrices.height || matrices.width != amplitudes.width || matrices.height != amplitudes.height
+			|| matrices.arraySize != amplitudes.arraySize) {
+			std::cout << "can't load " << baseFilename << ": expected RGBA32F and RG32F tables of the same size" << std::endl;
+			return false;
+		}
+		const size_t texels = (size_t)matrices.width * matrices.height * matrices.arraySize;
+		if (matrices.data.size() < sizeof(float) * 4 * texels || amplitudes.data.size() < sizeof(float) * 2 * texels) {
+			std::cout << "can't load " << baseFilename << ": truncated table" << std::endl;
+			return false;
+		}
+		return true;
+	}
+	bool PackTextures(const std::string& baseFilename)
+	{
+		DDSImage matrices, amplitudes;
+		if (!LoadTables(baseFilename, matrices, amplitudes)) return false;
+		return WritePackedTexture(baseFilename + "_packed.dds", reinterpret_cast<const float*>(matrices.data.data()),
+			reinterpret_cast<const float*>(amplitudes.data.data()), (int)matrices.width, (int)matrices.arraySize);
+	}
+	bool EmbedTextures(const std::string& baseFilename, const std::string& headerFilename)
+	{
+		DDSImage matrices, amplitudes;
+		if (!LoadTables(baseFilename, matrices, amplitudes)) return false;
+		const int N = (int)matrices.width;
+		const int layer_count = (int)matrices.arraySize;
+		float max_abs_error, max_rel_error;
+		std::vector<uint16_t> packed_data = PackHalf(reinterpret_cast<const float*>(matrices.data.data()),
+			reinterpret_cast<const float*>(amplitudes.data.data()), N, layer_count, max_abs_error, max_rel_error);
+
+		std::ofstream header(headerFilename);
+		if (!header) {
+			std::cout << "can't write " << headerFilename << std::endl;
+			return false;
+		}
+		std::string source = baseFilename.substr(baseFilename.find_last_of("/\\") + 1);
+		header << "#pragma once\n"
+			<< "// Generated by ltc_fit --embed from " << source << ".dds and " << source << "_amp.dds, do not edit\n"
+			<< "#include <cstdint>\n\n"
+			<< "namespace LTCTable {\n"
+			<< "\tconstexpr uint32_t Size = " << N << ";\n"
+			<< "\tconstexpr uint32_t LayerCount = " << 2 * layer_count << ";\n"
+			<< "\t// RGBA16F texels of the layers one after the other, laid out as in LTCFit::WritePackedTexture\n"
+			<< "\talignas(16) constexpr uint16_t Texels[] = {";
+		for (size_t i = 0; i < packed_data.size(); ++i) {
+			header << (i % 16 == 0 ? "\n\t\t" : " ") << packed_data[i] << ",";
+		}
+		header << "\n\t};\n}\n";
 
-				float epsilon = 0.05f;
-				// refine first guess by exploring parameter space
-				{
-					//float startFit[4] = { ltc.m11, ltc.m22, ltc.m13, ltc.m23 };
-					//float resultFit[4];
+		std::cout << "write packed M and amplitude to header: " << headerFilename << " (max error " << max_abs_error
+			<< ", max relative error " << max_rel_error << ")..." << std::endl;
+		return (bool)header;
+	}
+	// Fit the cell (a, t) and return its error. ltc holds the fit of (a, t - 1), the first cell of a row
+	// starts from (a + 1, 0) in tab
+	template<class TBRDF>
+	static float FitCell(const TBRDF& brdf, const FitSettings& settings, LTC& ltc, const int a, const int t, glm::mat3* tab, glm::vec2* tab_amp,
+		int& evaluations)
+	{
+		const int N = settings.resolution;
+		float theta = std::min(1.57f, t / (float)(N - 1) * 1.57079f);
+		const glm::vec3 V(sinf(theta), 0.f, cosf(theta));
 
-					//LTCFitter fitter(ltc, brdf, V, alpha, isotropic);
+		float roughness = a / (float)(N - 1);
+		float alpha = std::max(roughness * roughness, settings.minAlpha);
+#if DEBUG
+		std::cout << "a = " << a << "\t t = " << t << std::endl;
+		std::cout << "alpha = " << alpha << "\t theta = " << theta << std::endl;
+		std::cout << std::endl;
+#endif
+		// the BRDF side of the samples stays the same for every iteration of the fit
+		const BRDFSamples brdf_samples(brdf, V, alpha, settings.sampleCount);
+
+		//ltc.m_amplitude = ComputeNorm(brdf, V, alpha);
+		glm::vec3 avg_dir;
+		ComputeAverageValues(brdf_samples, V, avg_dir, ltc.m_amplitude, ltc.m_fresnel);
+		bool isotropic;
+
+		if (t == 0) {
+			ltc.X = glm::vec3(1, 0, 0);
+			ltc.Y = glm::vec3(0, 1, 0);
+			ltc.Z = glm::vec3(0, 0, 1);
+
+			if (a == N - 1) {
+				ltc.m11 = 1.f;
+				ltc.m22 = 1.f;
+			}
+			else {
+				ltc.m11 = std::max(tab[a + 1 + t * N][0][0], settings.minAlpha);
+				ltc.m22 = std::max(tab[a + 1 + t * N][1][1], settings.minAlpha);
+			}
 
-					//// Find best-fit LTC lobe (scale, alphax, alphay)
-					//float error = nelder_mead::NelderMead<4>(resultFit, startFit, epsilon, 1e-5f, 100, fitter);
+			ltc.m13 = 0;
+			ltc.m23 = 0;
+			ltc.Update();
+			isotropic = true;
+		}
+		else {
+			glm::vec3 L = glm::normalize(avg_dir);
+			glm::vec3 T1(L.z, 0, -L.x);
+			glm::vec3 T2(0, 1, 0);
+			//fit faster???
+			ltc.X = T1;
+			ltc.Y = T2;
+			ltc.Z = L;
+
+			ltc.Update();
+			isotropic = settings.isotropic;
+		}
 
-					//// Update LTC with best fitting values
-					//fitter.Update(resultFit);
+		float epsilon = 0.05f;
+		float error = 0.f;
+		// refine first guess by exploring parameter space
+		{
+			//float startFit[4] = { ltc.m11, ltc.m22, ltc.m13, ltc.m23 };
+			//float resultFit[4];
+
+			//LTCFitter fitter(ltc, brdf, V, alpha, isotropic);
+
+			//// Find best-fit LTC lobe (scale, alphax, alphay)
+			//float error = nelder_mead::NelderMead<4>(resultFit, startFit, epsilon, 1e-5f, 100, fitter);
+
+			//// Update LTC with best fitting values
+			//fitter.Update(resultFit);
+
+			float startFit[3] = { ltc.m11, ltc.m22, ltc.m13};
+			float resultFit[3];
+
+			LTCFitter fitter(ltc, brdf, brdf_samples, V, alpha, isotropic, settings.minAlpha);
+			evaluations = 0;
+			auto counted_fitter = [&](const float* params) { ++evaluations; return fitter(params); };
+
+			// Find best-fit LTC lobe (scale, alphax, alphay)
+			switch (settings.optimizer) {
+			case FitOptimizer::NelderMead:
+				error = nelder_mead::NelderMead<3>(resultFit, startFit, epsilon, 1e-5f, 100, counted_fitter);
+				break;
+			case FitOptimizer::BFGS:
+				error = bfgs::BFGS<3>(resultFit, startFit, epsilon, 1e-5f, 100, counted_fitter);
+				break;
+			default:
+				// release builds keep the start of the fit
+				assert(!"unknown FitOptimizer");
+				std::copy(std::begin(startFit), std::end(startFit), resultFit);
+				error = counted_fitter(resultFit);
+				break;
+			}
 
-					float startFit[3] = { ltc.m11, ltc.m22, ltc.m13};
-					float resultFit[3];
+			// Update LTC with best fitting values
+			fitter.Update(resultFit);
+		}
 
-					LTCFitter fitter(ltc, brdf, V, alpha, isotropic);
+		int cur_idx = a + t * N;
+		tab[cur_idx] = ltc.M;
+		tab_amp[cur_idx][0] = ltc.m_amplitude;
+		tab_amp[cur_idx][1] = ltc.m_fresnel;
 
-					// Find best-fit LTC lobe (scale, alphax, alphay)
-					float error = nelder_mead::NelderMead<3>(resultFit, startFit, epsilon, 1e-5f, 100, fitter);
+		tab[cur_idx][0][1] = 0;
+		tab[cur_idx][1][0] = 0;
+		tab[cur_idx][2][1] = 0;
+		tab[cur_idx][1][2] = 0;
+		//tab[cur_idx] = 1.f / tab[cur_idx][2][2] * tab[cur_idx];
+#if DEBUG
+		std::cout << tab[cur_idx][0][0] << "\t " << tab[cur_idx][1][0] << "\t " << tab[cur_idx][2][0] << std::endl;
+		std::cout << tab[cur_idx][0][1] << "\t " << tab[cur_idx][1][1] << "\t " << tab[cur_idx][2][1] << std::endl;
+		std::cout << tab[cur_idx][0][2] << "\t " << tab[cur_idx][1][2] << "\t " << tab[cur_idx][2][2] << std::endl;
+		std::cout << std::endl;
+#endif
+		return error;
+	}
 
-					// Update LTC with best fitting values
-					fitter.Update(resultFit);
+	// Fit one layer of N * N cells of the table to brdf, the calls to it are resolved at compile time
+	template<class TBRDF>
+	static void FitTable(const TBRDF& brdf, const FitSettings& settings, glm::mat3* tab, glm::vec2* tab_amp, float* errors, int* evaluations)
+	{
+		const int N = settings.resolution;
+
+		// Every cell but the first of a row starts from the fit of the previous theta, so a row is serial.
+		// A row only waits for the first cell of the row above (a + 1), rows run as a wavefront: each thread
+		// takes the next row and fits it with its own LTC in the serial order, the table matches a serial run.
+		std::vector<std::promise<void>> first_cell(N);
+		std::vector<std::shared_future<void>> first_cell_done(N);
+		for (int a = 0; a < N; ++a) first_cell_done[a] = first_cell[a].get_future().share();
+
+		std::atomic<int> next_row{ N - 1 };
+		int finished_rows = 0;
+		std::mutex progress_mutex;
+		auto fit_rows = [&]() {
+			for (int a = next_row--; a >= 0; a = next_row--) {
+				if (a < N - 1) first_cell_done[a + 1].wait();
+
+				LTC ltc;
+				for (int t = 0; t <= N - 1; ++t) {
+					errors[a + t * N] = FitCell(brdf, settings, ltc, a, t, tab, tab_amp, evaluations[a + t * N]);
+					if (t == 0) first_cell[a].set_value();
 				}
 
-				int cur_idx = a + t * N;
-				tab[cur_idx] = ltc.M;
-				tab_amp[cur_idx][0] = ltc.m_amplitude;
-				tab_amp[cur_idx][1] = ltc.m_fresnel;
+				std::lock_guard<std::mutex> lock(progress_mutex);
+				std::cout << "ltc progress: " << ++finished_rows << "/" << N << std::endl;
+			}
+		};
+
+		unsigned int thread_count = settings.threadCount;
+		if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min<unsigned int>(thread_count, N); ++i) {
+			threads.emplace_back(fit_rows);
+		}
+		fit_rows();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
 
-				tab[cur_idx][0][1] = 0;
-				tab[cur_idx][1][0] = 0;
-				tab[cur_idx][2][1] = 0;
-				tab[cur_idx][1][2] = 0;
-				//tab[cur_idx] = 1.f / tab[cur_idx][2][2] * tab[cur_idx];
-#if DEBUG
-				std::cout << tab[cur_idx][0][0] << "\t " << tab[cur_idx][1][0] << "\t " << tab[cur_idx][2][0] << std::endl;
-				std::cout << tab[cur_idx][0][1] << "\t " << tab[cur_idx][1][1] << "\t " << tab[cur_idx][2][1] << std::endl;
-				std::cout << tab[cur_idx][0][2] << "\t " << tab[cur_idx][1][2] << "\t " << tab[cur_idx][2][2] << std::endl;
-				std::cout << std::endl;
-#endif
+	}
+
+	FitReport GenerateTexture(const std::string& baseFilename, const FitSettings& settings)
+	{
+		const int N = settings.resolution;
+		const int layer_count = (int)settings.brdfs.size();
+		glm::mat3* tab = new glm::mat3[N * N * layer_count];
+		glm::vec2* tab_amp = new glm::vec2[N * N * layer_count];
+		FitReport report;
+		report.errors.resize(N * N * layer_count);
+		report.evaluations.resize(N * N * layer_count);
+		std::cout << "start" << std::endl;
+		auto start = std::chrono::steady_clock::now();
+
+		for (int layer = 0; layer < layer_count; ++layer) {
+			std::cout << "layer " << layer + 1 << "/" << layer_count << std::endl;
+			const int offset = layer * N * N;
+			switch (settings.brdfs[layer]) {
+			case BRDFModel::GGX:
+				FitTable(BRDFGGX(), settings, tab + offset, tab_amp + offset, report.errors.data() + offset, report.evaluations.data() + offset);
+				break;
+			case BRDFModel::GGXSeparable:
+				FitTable(BRDFGGXSeparable(), settings, tab + offset, tab_amp + offset, report.errors.data() + offset, report.evaluations.data() + offset);
+				break;
+			case BRDFModel::DisneyDiffuse:
+				FitTable(BRDFDisneyDiffuse(), settings, tab + offset, tab_amp + offset, report.errors.data() + offset, report.evaluations.data() + offset);
+				break;
+			case BRDFModel::Sheen:
+				FitTable(BRDFSheen(), settings, tab + offset, tab_amp + offset, report.errors.data() + offset, report.evaluations.data() + offset);
+				break;
 			}
-			std::cout << "ltc progress: " << (N - a) << "/" << N << std::endl;
 		}
+
+		report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 		std::cout << "end" << std::endl;
-		WriteToTextures(baseFilename, tab, tab_amp, N);
+		WriteToTextures(baseFilename, tab, tab_amp, N, layer_count, settings.packHalf);
 		delete[] tab;
 		delete[] tab_amp;
 		std::cout << "texture generated" << std::endl;
+		return report;
+	}
+	void GenerateTexture(const std::string& baseFilename, unsigned int threadCount)
+	{
+		FitSettings settings;
+		settings.threadCount = threadCount;
+		GenerateTexture(baseFilename, settings);
+	}
+
+	// Fit the anisotropic cell of V and return its error. ltc holds the fit of the previous theta, or the
+	// starting lobe for theta = 0.
+	static float FitAnisotropicCell(const BRDFGGXAnisotropic& brdf, const AnisotropicFitSettings& settings, LTC& ltc, const glm::vec3& V,
+		const bool first, int& evaluations)
+	{
+		const BRDFSamples brdf_samples(brdf, V, 0.f, settings.sampleCount);
+		// V is out of the xz plane for phi > 0, so is the average direction
+		glm::vec3 avg_dir;
+		ComputeAverageValues(brdf_samples, V, avg_dir, ltc.m_amplitude, ltc.m_fresnel, true);
+
+		// frame around the average direction with X towards V, the frame of the 2D fit rotated by phi
+		if (first) {
+			ltc.X = glm::vec3(1, 0, 0);
+			ltc.Y = glm::vec3(0, 1, 0);
+			ltc.Z = glm::vec3(0, 0, 1);
+		}
+		else {
+			ltc.Z = avg_dir;
+			const glm::vec3 towards_v = V - glm::dot(V, ltc.Z) * ltc.Z;
+			// V along Z leaves the plane undefined, keep the azimuth of the previous frame
+			ltc.X = glm::normalize(glm::length(towards_v) > 1e-4f ? towards_v : ltc.X - glm::dot(ltc.X, ltc.Z) * ltc.Z);
+			ltc.Y = glm::cross(ltc.Z, ltc.X);
+		}
+		ltc.Update();
+
+		float startFit[4] = { ltc.m11, ltc.m22, ltc.m13, ltc.m23 };
+		float resultFit[4];
+		LTCFitter fitter(ltc, brdf, brdf_samples, V, 0.f, false, settings.minAlpha, 4);
+		evaluations = 0;
+		auto counted_fitter = [&](const float* params) { ++evaluations; return fitter(params); };
+
+		float error = 0.f;
+		switch (settings.optimizer) {
+		case FitOptimizer::NelderMead:
+			error = nelder_mead::NelderMead<4>(resultFit, startFit, 0.05f, 1e-5f, 100, counted_fitter);
+			break;
+		case FitOptimizer::BFGS:
+			error = bfgs::BFGS<4>(resultFit, startFit, 0.05f, 1e-5f, 100, counted_fitter);
+			break;
+		default:
+			assert(!"unknown FitOptimizer");
+			std::copy(std::begin(startFit), std::end(startFit), resultFit);
+			error = counted_fitter(resultFit);
+			break;
+		}
+		fitter.Update(resultFit);
+		return error;
+	}
+
+	AnisotropicFitReport GenerateAnisotropicTexture(const std::string& baseFilename, const AnisotropicFitSettings& settings)
+	{
+		const int T = settings.thetaCount, P = settings.phiCount, A = settings.alphaCount;
+		const int cell_count = T * P * A * A;
+		// 3 RGBA16F texels per cell, layer 3 * (t + T * p) + k holds the (ax, ay) slice
+		std::vector<uint16_t> texels(4 * 3 * cell_count, 0);
+		AnisotropicFitReport report;
+		report.errors.resize(cell_count);
+		report.evaluations.resize(cell_count);
+		std::cout << "start anisotropic " << T << "x" << P << "x" << A << "x" << A << std::endl;
+		auto start = std::chrono::steady_clock::now();
+
+		// Rows of (phi, alphaX, alphaY) are independent, each walks theta up from the normal and starts every
+		// cell from the previous one. Threads take the next row.
+		std::atomic<int> next_row{ 0 };
+		std::atomic<int> finished_rows{ 0 };
+		std::mutex progress_mutex;
+		auto fit_rows = [&]() {
+			for (int row = next_row++; row < P * A * A; row = next_row++) {
+				const int p = row % P, ax = (row / P) % A, ay = row / (P * A);
+				const float phi = p / (float)std::max(P - 1, 1) * 1.57079f;
+				const float roughness_x = ax / (float)(A - 1), roughness_y = ay / (float)(A - 1);
+				const BRDFGGXAnisotropic brdf(std::max(roughness_x * roughness_x, settings.minAlpha),
+					std::max(roughness_y * roughness_y, settings.minAlpha));
+
+				LTC ltc;
+				ltc.m11 = brdf.alphaX;
+				ltc.m22 = brdf.alphaY;
+				for (int t = 0; t < T; ++t) {
+					const float theta = std::min(1.57f, t / (float)(T - 1) * 1.57079f);
+					const glm::vec3 V(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta));
+					const int cell = t + T * row;
+					report.errors[cell] = FitAnisotropicCell(brdf, settings, ltc, V, t == 0, report.evaluations[cell]);
+
+					glm::mat3 invM = ltc.invM;
+					invM /= cbrtf(glm::determinant(invM));
+					const float terms[12] = {
+						invM[0][0], invM[1][0], invM[2][0], invM[0][1],
+						invM[1][1], invM[2][1], invM[0][2], invM[1][2],
+						invM[2][2], ltc.m_amplitude, ltc.m_fresnel, 0.f };
+					for (int k = 0; k < 3; ++k) {
+						uint16_t* texel = &texels[4 * ((3 * (t + T * p) + k) * A * A + ax + A * ay)];
+						for (int c = 0; c < 4; ++c) texel[c] = VK_Renderer::FloatToHalf(terms[4 * k + c]);
+					}
+				}
+
+				const int finished = ++finished_rows;
+				if (finished % std::max(P * A * A / 100, 1) == 0) {
+					std::lock_guard<std::mutex> lock(progress_mutex);
+					std::cout << "ltc progress: " << finished << "/" << P * A * A << std::endl;
+				}
+			}
+		};
+
+		unsigned int thread_count = settings.threadCount;
+		if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min<unsigned int>(thread_count, P * A * A); ++i) {
+			threads.emplace_back(fit_rows);
+		}
+		fit_rows();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		report.bytes = texels.size() * sizeof(uint16_t);
+		const std::string filename = baseFilename + "_aniso.dds";
+		std::cout << "write anisotropic table to texture: " << filename << " (" << report.bytes << " bytes)..." << std::endl;
+		SaveDDSArray(filename.c_str(), DDS_FORMAT_R16G16B16A16_FLOAT, sizeof(uint16_t) * 4, A, A, 3 * T * P, texels.data());
+		return report;
 	}
 }
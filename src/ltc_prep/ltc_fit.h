@@ -3,19 +3,111 @@
 #include "brdf.h"
 
 namespace LTCFit {
+	// Minimizer of the error of a cell, started from the fit of the previous theta
+	enum class FitOptimizer {
+		NelderMead,		// downhill simplex, builds the table the renderer ships with
+		BFGS			// quasi-Newton with finite difference gradients, see bfgs.h
+	};
+	// Table size and fit quality, the defaults build the table the renderer ships with
+	struct FitSettings {
+		int resolution = 64;			// size of precomputed table (theta, alpha)
+		int sampleCount = 50;			// samples per axis of the grid used to compute the error during fitting
+		float minAlpha = 0.0001f;		// minimal roughness (avoid singularities)
+		std::vector<BRDFModel> brdfs = { BRDFModel::GGX };	// one layer of the table per model, in this order
+		bool isotropic = false;			// fit every cell with an isotropic lobe, one free parameter instead of three
+		unsigned int threadCount = 0;	// 0: hardware concurrency
+		bool packHalf = false;			// also write baseFilename_packed.dds, see WritePackedTexture
+		FitOptimizer optimizer = FitOptimizer::NelderMead;
+	};
+	struct FitReport {
+		double seconds = 0.0;
+		std::vector<float> errors;		// final error of each cell, at a + t * resolution + layer * resolution^2
+		std::vector<int> evaluations;	// error evaluations of the optimizer for each cell, same layout
+	};
+
+	struct SampleGrid;
+	// BRDF-sampled directions of the stratified sample grid with the BRDF value and pdf at each of them.
+	// They only depend on (V, alpha), a cell builds them once and every fitter iteration reuses them.
+	struct BRDFSamples {
+		const SampleGrid* grid;
+		SampleBatch L;
+		std::vector<float> eval, pdf;
+		template<class TBRDF>
+		BRDFSamples(const TBRDF& brdf, const glm::vec3& V, const float alpha, const int sampleCount = FitSettings().sampleCount);
+	};
+	// MIS weighted error of the LTC against the BRDF on the stratified sample grid, batched over the SIMD lanes
 	float ComputeError(const LTC& ltc, const BRDF& brdf, const glm::vec3& V, const float alpha);
+	// Same with the BRDF side taken from brdfSamples, only the LTC-sampled half is evaluated.
+	// Specialized on the BRDF type (BRDF or one of the models), defined in ltc_fit.cpp.
+	template<class TBRDF>
+	float ComputeError(const LTC& ltc, const TBRDF& brdf, const BRDFSamples& brdfSamples, const glm::vec3& V, const float alpha);
+	// Same error one sample at a time, kept as the reference for the batched one
+	float ComputeErrorReference(const LTC& ltc, const BRDF& brdf, const glm::vec3& V, const float alpha, const int sampleCount = FitSettings().sampleCount);
 	void ComputeAverageValues(const BRDF& brdf, const glm::vec3& V, const float alpha, glm::vec3& avg_dir, float& avg_n, float& avg_fresnel);
+	// Normalized BRDF weighted average direction, albedo and fresnel term of the samples. The y of the direction
+	// is cleared unless keepY, it is only nonzero for a V out of the xz plane or an anisotropic BRDF.
+	void ComputeAverageValues(const BRDFSamples& brdfSamples, const glm::vec3& V, glm::vec3& avg_dir, float& avg_n, float& avg_fresnel,
+		const bool keepY = false);
+	// Set the LTC from the fitted (m11, m22, m13), an isotropic lobe only uses m11. With paramCount 4
+	// params also holds m23, the lobe of an anisotropic BRDF leans out of the plane of V.
+	void SetFitParameters(LTC& ltc, const float* params, const bool isotropic, const float minAlpha, const int paramCount = 3);
+	template<class TBRDF = BRDF>
 	struct LTCFitter {
 		LTC& m_ltc;
-		const BRDF& m_brdf;
+		const TBRDF& m_brdf;
+		const BRDFSamples& m_brdfSamples;
 		const glm::vec3 m_view;
 		const float m_alpha;
 		const bool m_isotropic;
-		LTCFitter(LTC& _ltc, const BRDF& _brdf, const glm::vec3& V, const float _alpha, const bool _isotropic = false)
-			:m_ltc(_ltc), m_brdf(_brdf), m_view(V), m_alpha(_alpha), m_isotropic(_isotropic) {};
-		void Update(const float* params);
-		float operator()(const float* params);
+		const float m_minAlpha;
+		const int m_paramCount;
+		LTCFitter(LTC& _ltc, const TBRDF& _brdf, const BRDFSamples& _brdfSamples, const glm::vec3& V, const float _alpha, const bool _isotropic = false,
+			const float _minAlpha = FitSettings().minAlpha, const int _paramCount = 3)
+			:m_ltc(_ltc), m_brdf(_brdf), m_brdfSamples(_brdfSamples), m_view(V), m_alpha(_alpha), m_isotropic(_isotropic), m_minAlpha(_minAlpha),
+			m_paramCount(_paramCount) {};
+		void Update(const float* params) { SetFitParameters(m_ltc, params, m_isotropic, m_minAlpha, m_paramCount); }
+		float operator()(const float* params) {
+			Update(params);
+			return ComputeError(m_ltc, m_brdf, m_brdfSamples, m_view, m_alpha);
+		}
+	};
+	// layerCount tables of N * N cells one after the other, written as texture arrays
+	void WriteToTextures(const std::string& filename, const glm::mat3* tab, const glm::vec2* tab_amp, const int N, const int layerCount = 1,
+		const bool packed = false);
+	// Both tables in one RGBA16F texture array, layer 2k holds the inverse M terms of table k and layer 2k + 1
+	// (amplitude, fresnel, 0, 0). invM has 4 and amp 2 floats per cell. Prints the error of the half packing.
+	bool WritePackedTexture(const std::string& filename, const float* invM, const float* amp, const int N, const int layerCount);
+	// Pack the existing baseFilename.dds and baseFilename_amp.dds into baseFilename_packed.dds
+	bool PackTextures(const std::string& baseFilename);
+	// Same packing written to a C++ header as LTCTable::Texels, for builds that compile the table in
+	bool EmbedTextures(const std::string& baseFilename, const std::string& headerFilename);
+	// Fit the (theta, alpha) table on settings.threadCount threads and write it to baseFilename.dds and
+	// baseFilename_amp.dds. The table does not depend on the thread count.
+	FitReport GenerateTexture(const std::string& baseFilename, const FitSettings& settings);
+	// Default table on threadCount threads (0: hardware concurrency)
+	void GenerateTexture(const std::string& baseFilename, unsigned int threadCount = 0);
+
+	// 4D table of anisotropic GGX over the (theta, phi) of V and (alphaX, alphaY). phi only covers [0, pi/2],
+	// anisotropic GGX is symmetric about the x and y axes so the other quadrants mirror V and the lobe.
+	struct AnisotropicFitSettings {
+		int thetaCount = 16;
+		int phiCount = 8;
+		int alphaCount = 16;			// per axis, roughness = sqrt(alpha) in [0, 1] as in the 2D table
+		int sampleCount = 32;			// samples per axis of the error grid
+		float minAlpha = FitSettings().minAlpha;
+		unsigned int threadCount = 0;	// 0: hardware concurrency
+		FitOptimizer optimizer = FitOptimizer::NelderMead;
+	};
+	struct AnisotropicFitReport {
+		double seconds = 0.0;
+		size_t bytes = 0;				// size of the texel data written
+		// final error and optimizer evaluations of each cell, at t + thetaCount * (p + phiCount * (ax + alphaCount * ay))
+		std::vector<float> errors;
+		std::vector<int> evaluations;
 	};
-	void WriteToTextures(const std::string& filename, const glm::mat3* tab, const glm::vec2* tab_amp, const int N);
-	void GenerateTexture(const std::string& baseFilename);
+	// Fit the 4D table and write it to baseFilename_aniso.dds, an RGBA16F texture array of alphaCount^2 texels
+	// (alphaX to the right, alphaY down) with 3 layers per (theta, phi) at 3 * (t + thetaCount * p). They hold
+	// the inverse M scaled to a determinant of 1, mRowColumn in (m00 m01 m02 m10) (m11 m12 m20 m21), and
+	// (m22 amplitude fresnel 0). The lobe leaves the plane of V, so all 9 terms are stored.
+	AnisotropicFitReport GenerateAnisotropicTexture(const std::string& baseFilename, const AnisotropicFitSettings& settings);
 }
@@ -0,0 +1,58 @@
+#pragma once
+// Float lanes for the batched LTC and BRDF evaluation, 8 wide with AVX2, 4 with SSE, scalar otherwise
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define LTC_USE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define LTC_USE_SSE
+#endif
+#include <algorithm>
+#include <cmath>
+
+namespace ltc_simd {
+#if defined(LTC_USE_AVX2)
+	using Lanes = __m256;
+	static constexpr int Width = 8;
+	inline Lanes Load(const float* p) { return _mm256_loadu_ps(p); }
+	inline void Store(float* p, const Lanes v) { _mm256_storeu_ps(p, v); }
+	inline Lanes Set(const float v) { return _mm256_set1_ps(v); }
+	inline Lanes Add(const Lanes a, const Lanes b) { return _mm256_add_ps(a, b); }
+	inline Lanes Sub(const Lanes a, const Lanes b) { return _mm256_sub_ps(a, b); }
+	inline Lanes Mul(const Lanes a, const Lanes b) { return _mm256_mul_ps(a, b); }
+	inline Lanes Div(const Lanes a, const Lanes b) { return _mm256_div_ps(a, b); }
+	inline Lanes Sqrt(const Lanes a) { return _mm256_sqrt_ps(a); }
+	inline Lanes Max(const Lanes a, const Lanes b) { return _mm256_max_ps(a, b); }
+	inline Lanes Abs(const Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+	// b where a > 0, 0 elsewhere
+	inline Lanes SelectPositive(const Lanes a, const Lanes b) { return _mm256_and_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ), b); }
+#elif defined(LTC_USE_SSE)
+	using Lanes = __m128;
+	static constexpr int Width = 4;
+	inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+	inline void Store(float* p, const Lanes v) { _mm_storeu_ps(p, v); }
+	inline Lanes Set(const float v) { return _mm_set1_ps(v); }
+	inline Lanes Add(const Lanes a, const Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes Sub(const Lanes a, const Lanes b) { return _mm_sub_ps(a, b); }
+	inline Lanes Mul(const Lanes a, const Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes Div(const Lanes a, const Lanes b) { return _mm_div_ps(a, b); }
+	inline Lanes Sqrt(const Lanes a) { return _mm_sqrt_ps(a); }
+	inline Lanes Max(const Lanes a, const Lanes b) { return _mm_max_ps(a, b); }
+	inline Lanes Abs(const Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	inline Lanes SelectPositive(const Lanes a, const Lanes b) { return _mm_and_ps(_mm_cmpgt_ps(a, _mm_setzero_ps()), b); }
+#else
+	using Lanes = float;
+	static constexpr int Width = 1;
+	inline Lanes Load(const float* p) { return *p; }
+	inline void Store(float* p, const Lanes v) { *p = v; }
+	inline Lanes Set(const float v) { return v; }
+	inline Lanes Add(const Lanes a, const Lanes b) { return a + b; }
+	inline Lanes Sub(const Lanes a, const Lanes b) { return a - b; }
+	inline Lanes Mul(const Lanes a, const Lanes b) { return a * b; }
+	inline Lanes Div(const Lanes a, const Lanes b) { return a / b; }
+	inline Lanes Sqrt(const Lanes a) { return sqrtf(a); }
+	inline Lanes Max(const Lanes a, const Lanes b) { return std::max(a, b); }
+	inline Lanes Abs(const Lanes a) { return fabsf(a); }
+	inline Lanes SelectPositive(const Lanes a, const Lanes b) { return a > 0.f ? b : 0.f; }
+#endif
+}
@@ -0,0 +1,218 @@
+#include "ltc_validate.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <stb_image_write.h>
+#include <dds.h>
+
+namespace LTCFit {
+	static constexpr float PI = 3.14159265f;
+
+	// Test polygons in the frame of the fit (normal +z, V in the xz plane towards +x), the Monte Carlo estimate
+	// assumes they are planar and convex
+	static const glm::vec3 TestPolygons[][4] = {
+		// small and large light overhead
+		{ { -0.25f, -0.25f, 1.f }, { 0.25f, -0.25f, 1.f }, { 0.25f, 0.25f, 1.f }, { -0.25f, 0.25f, 1.f } },
+		{ { -2.f, -2.f, 1.f }, { 2.f, -2.f, 1.f }, { 2.f, 2.f, 1.f }, { -2.f, 2.f, 1.f } },
+		// walls on the side of the mirror direction and on the side of V
+		{ { -1.f, -1.f, 0.05f }, { -1.f, 1.f, 0.05f }, { -1.f, 1.f, 2.f }, { -1.f, -1.f, 2.f } },
+		{ { 1.f, -1.f, 0.05f }, { 1.f, 1.f, 0.05f }, { 1.f, 1.f, 2.f }, { 1.f, -1.f, 2.f } },
+		// crossing the horizon, the LTC side clips it like mesh_ltc.frag
+		{ { -1.f, 1.f, -0.5f }, { 1.f, 1.f, -0.5f }, { 1.f, 1.f, 1.f }, { -1.f, 1.f, 1.f } },
+	};
+	static constexpr int TestPolygonCount = sizeof(TestPolygons) / sizeof(TestPolygons[0]);
+
+	// Bilinear lookup of layer at (roughness, theta) with texel centers at roughness * (N - 1) and
+	// 2 * theta / pi * (N - 1), as the sampler in mesh_ltc.frag does. Returns the inverse M and the amplitude.
+	static glm::mat3 LookupTable(const float* invM, const float* amp, const int N, const int layer, const float roughness,
+		const float theta, float& amplitude)
+	{
+		const float x = std::clamp(roughness, 0.f, 1.f) * (N - 1);
+		const float y = std::clamp(2.f * theta / PI, 0.f, 1.f) * (N - 1);
+		const int x0 = std::min((int)x, N - 2), y0 = std::min((int)y, N - 2);
+		const float fx = x - x0, fy = y - y0;
+
+		float terms[4] = { 0.f, 0.f, 0.f, 0.f };
+		amplitude = 0.f;
+		for (int corner = 0; corner < 4; ++corner) {
+			const int cx = x0 + (corner & 1), cy = y0 + (corner >> 1);
+			const float weight = ((corner & 1) ? fx : 1.f - fx) * ((corner >> 1) ? fy : 1.f - fy);
+			const int cell = cx + cy * N + layer * N * N;
+			for (int c = 0; c < 4; ++c) terms[c] += weight * invM[4 * cell + c];
+			amplitude += weight * amp[2 * cell];
+		}
+		// same layout as LTCMatrix in mesh_ltc.frag
+		return glm::mat3(
+			glm::vec3(terms[0], 0.f, terms[2]),
+			glm::vec3(0.f, 1.f, 0.f),
+			glm::vec3(terms[1], 0.f, terms[3]));
+	}
+
+	// Integral of the clamped cosine over the polygon transformed by invM, clipped to the upper hemisphere
+	static float IntegrateClippedCosine(const glm::mat3& invM, const glm::vec3 (&polygon)[4])
+	{
+		glm::vec3 transformed[4];
+		for (int i = 0; i < 4; ++i) transformed[i] = invM * polygon[i];
+
+		// clip against z = 0 one edge at a time, a quad gains at most one vertex
+		glm::vec3 clipped[5];
+		int count = 0;
+		for (int i = 0; i < 4; ++i) {
+			const glm::vec3& a = transformed[i];
+			const glm::vec3& b = transformed[(i + 1) % 4];
+			if (a.z > 0.f) clipped[count++] = a;
+			if ((a.z > 0.f) != (b.z > 0.f)) clipped[count++] = a + (b - a) * (a.z / (a.z - b.z));
+		}
+		if (count < 3) return 0.f;
+
+		float sum = 0.f;
+		for (int i = 0; i < count; ++i) {
+			const glm::vec3 p_i = glm::normalize(clipped[i]);
+			const glm::vec3 p_j = glm::normalize(clipped[(i + 1) % count]);
+			const glm::vec3 normal = glm::cross(p_i, p_j);
+			const float length = glm::length(normal);
+			if (length < 1e-7f) continue;
+			sum += acosf(std::clamp(glm::dot(p_i, p_j), -1.f, 1.f)) * normal.z / length;
+		}
+		// the test polygons are two sided
+		return fabsf(sum) / (2.f * PI);
+	}
+
+	static bool RayHitsPolygon(const glm::vec3& L, const glm::vec3 (&polygon)[4])
+	{
+		const glm::vec3 normal = glm::cross(polygon[1] - polygon[0], polygon[2] - polygon[0]);
+		const float denom = glm::dot(normal, L);
+		if (fabsf(denom) < 1e-9f) return false;
+		const float t = glm::dot(normal, polygon[0]) / denom;
+		if (t <= 0.f) return false;
+		const glm::vec3 hit = t * L;
+		for (int i = 0; i < 4; ++i) {
+			if (glm::dot(glm::cross(polygon[(i + 1) % 4] - polygon[i], hit - polygon[i]), normal) < 0.f) return false;
+		}
+		return true;
+	}
+
+	// Greyscale map of one value per cell, clamped to scale, each cell drawn as a block of pixels
+	static bool WriteErrorMap(const std::string& filename, const std::vector<float>& map, const int gridSize, const int layerCount,
+		const float scale)
+	{
+		const int block = std::max(1, 256 / gridSize);
+		const int width = gridSize * block * layerCount, height = gridSize * block;
+		std::vector<unsigned char> pixels(width * height);
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x) {
+				const int layer = x / (gridSize * block);
+				const int r = (x % (gridSize * block)) / block, t = y / block;
+				const float value = std::min(map[r + t * gridSize + layer * gridSize * gridSize] / scale, 1.f);
+				pixels[x + y * width] = (unsigned char)(value * 255.f + 0.5f);
+			}
+		std::cout << "write error map: " << filename << "..." << std::endl;
+		return stbi_write_png(filename.c_str(), width, height, 1, pixels.data(), width) != 0;
+	}
+
+	ValidationReport ValidateTable(const std::string& baseFilename, const ValidationSettings& settings, const std::string& imageFilename)
+	{
+		ValidationReport report;
+		DDSImage matrices = LoadDDS((baseFilename + ".dds").c_str());
+		DDSImage amplitudes = LoadDDS((baseFilename + "_amp.dds").c_str());
+		if (matrices.format != VK_FORMAT_R32G32B32A32_SFLOAT || amplitudes.format != VK_FORMAT_R32G32_SFLOAT
+			|| matrices.width != matrices.height || matrices.width != amplitudes.width || matrices.height != amplitudes.height
+			|| matrices.arraySize != amplitudes.arraySize || matrices.width < 2) {
+			std::cout << "can't validate " << baseFilename << ": expected RGBA32F and RG32F tables of the same size" << std::endl;
+			return report;
+		}
+		const int N = (int)matrices.width;
+		const int layer_count = (int)settings.brdfs.size();
+		if (layer_count > (int)matrices.arraySize || matrices.data.size() < sizeof(float) * 4 * N * N * matrices.arraySize
+			|| amplitudes.data.size() < sizeof(float) * 2 * N * N * amplitudes.arraySize) {
+			std::cout << "can't validate " << baseFilename << ": " << matrices.arraySize << " layers for "
+				<< layer_count << " brdfs or truncated table" << std::endl;
+			return report;
+		}
+		const float* invM = reinterpret_cast<const float*>(matrices.data.data());
+		const float* amp = reinterpret_cast<const float*>(amplitudes.data.data());
+		report.loaded = true;
+
+		std::vector<std::unique_ptr<BRDF>> brdfs;
+		for (BRDFModel model : settings.brdfs) brdfs.push_back(CreateBRDF(model));
+
+		const int G = settings.gridSize;
+		const int S = settings.sampleCount;
+		// squared and max error of each cell and polygon
+		std::vector<float> squared_errors(G * G * layer_count * TestPolygonCount);
+		report.rmseMap.resize(G * G * layer_count);
+		report.maxMap.resize(G * G * layer_count);
+
+		std::atomic<int> next_cell{ 0 };
+		auto validate_cells = [&]() {
+			std::vector<float> U1(S * S), U2(S * S), eval, pdf;
+			SampleBatch L;
+			for (int cell = next_cell++; cell < G * G * layer_count; cell = next_cell++) {
+				const int r = cell % G, t = (cell / G) % G, layer = cell / (G * G);
+				const float roughness = r / (float)(G - 1);
+				const float theta = std::min(1.57f, t / (float)(G - 1) * 1.57079f);
+				const glm::vec3 V(sinf(theta), 0.f, cosf(theta));
+				const float alpha = std::max(roughness * roughness, settings.minAlpha);
+
+				// jittered strata, the seed only depends on the cell so the report is reproducible
+				std::mt19937 rng(cell);
+				std::uniform_real_distribution<float> jitter(0.f, 1.f);
+				for (int j = 0, n = 0; j < S; ++j)
+					for (int i = 0; i < S; ++i, ++n) {
+						U1[n] = std::min((i + jitter(rng)) / S, 0.99999f);
+						U2[n] = std::min((j + jitter(rng)) / S, 0.99999f);
+					}
+				const BRDF& brdf = *brdfs[layer];
+				brdf.Sample(V, alpha, U1.data(), U2.data(), S * S, L);
+				eval.resize(L.PaddedCount());
+				pdf.resize(L.PaddedCount());
+				brdf.Eval(V, L, alpha, eval.data(), pdf.data());
+
+				float amplitude;
+				const glm::mat3 cell_invM = LookupTable(invM, amp, N, layer, roughness, theta, amplitude);
+				float sum = 0.f, max_error = 0.f;
+				for (int p = 0; p < TestPolygonCount; ++p) {
+					double reference = 0.0;
+					for (int i = 0; i < L.count; ++i) {
+						if (pdf[i] > 0.f && eval[i] > 0.f && RayHitsPolygon(L.Get(i), TestPolygons[p])) reference += eval[i] / pdf[i];
+					}
+					reference /= L.count;
+					const float error = fabsf(amplitude * IntegrateClippedCosine(cell_invM, TestPolygons[p]) - (float)reference);
+					squared_errors[cell * TestPolygonCount + p] = error * error;
+					sum += error * error;
+					max_error = std::max(max_error, error);
+				}
+				report.rmseMap[cell] = sqrtf(sum / TestPolygonCount);
+				report.maxMap[cell] = max_error;
+			}
+		};
+
+		unsigned int thread_count = settings.threadCount;
+		if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < thread_count; ++i) {
+			threads.emplace_back(validate_cells);
+		}
+		validate_cells();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		for (int layer = 0; layer < layer_count; ++layer) {
+			const int begin = layer * G * G;
+			double sum = 0.0;
+			for (int i = begin * TestPolygonCount; i < (begin + G * G) * TestPolygonCount; ++i) sum += squared_errors[i];
+			report.rmse.push_back((float)sqrt(sum / (G * G * TestPolygonCount)));
+			report.maxError.push_back(*std::max_element(report.maxMap.begin() + begin, report.maxMap.begin() + begin + G * G));
+		}
+
+		if (!imageFilename.empty()) {
+			WriteErrorMap(imageFilename + "_rmse.png", report.rmseMap, G, layer_count, settings.errorScale);
+			WriteErrorMap(imageFilename + "_max.png", report.maxMap, G, layer_count, settings.errorScale);
+		}
+		return report;
+	}
+}
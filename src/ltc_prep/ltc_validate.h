@@ -0,0 +1,31 @@
+#pragma once
+#include "brdf.h"
+#include <string>
+#include <vector>
+
+namespace LTCFit {
+	// Grid the table is checked on and how it is reported, see ValidateTable
+	struct ValidationSettings {
+		int gridSize = 16;				// (roughness, theta) cells checked per layer
+		int sampleCount = 128;			// stratified Monte Carlo samples per axis for each polygon
+		float minAlpha = 0.0001f;		// same clamp as FitSettings::minAlpha
+		std::vector<BRDFModel> brdfs = { BRDFModel::GGX };	// model of each layer of the table
+		float errorScale = 0.05f;		// error drawn white in the maps
+		unsigned int threadCount = 0;	// 0: hardware concurrency
+	};
+	struct ValidationReport {
+		bool loaded = false;
+		// over all cells and test polygons of each layer
+		std::vector<float> rmse, maxError;
+		// per cell of each layer at r + t * gridSize + layer * gridSize^2, over the test polygons
+		std::vector<float> rmseMap, maxMap;
+	};
+
+	// Load baseFilename.dds and baseFilename_amp.dds and compare, for a grid of roughness and view angles, the
+	// integral of BRDF * cos over a few test polygons computed with the table (looked up and interpolated as
+	// mesh_ltc.frag does) with a Monte Carlo estimate from BRDF::Sample and BRDF::Eval. The error is absolute,
+	// both integrals are at most 1. If imageFilename is not empty the maps are written to imageFilename_rmse.png
+	// and imageFilename_max.png, roughness to the right and theta down, one layer after the other.
+	ValidationReport ValidateTable(const std::string& baseFilename, const ValidationSettings& settings,
+		const std::string& imageFilename = "");
+}
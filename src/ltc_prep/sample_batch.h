@@ -0,0 +1,31 @@
+#pragma once
+#include <glm.hpp>
+#include <vector>
+
+// Directions in structure of arrays for the batched Eval and Sample of LTC and BRDF.
+// The arrays are padded to a multiple of Padding (a multiple of every SIMD width) with the last direction,
+// count is the number of real directions.
+struct SampleBatch {
+	static constexpr int Padding = 8;
+	int count = 0;
+	std::vector<float> x, y, z;
+
+	void Resize(const int n) {
+		count = n;
+		const int padded = (n + Padding - 1) / Padding * Padding;
+		x.resize(padded);
+		y.resize(padded);
+		z.resize(padded);
+	}
+	inline int PaddedCount() const { return (int)x.size(); }
+	inline void Set(const int i, const glm::vec3& d) { x[i] = d.x; y[i] = d.y; z[i] = d.z; }
+	inline glm::vec3 Get(const int i) const { return glm::vec3(x[i], y[i], z[i]); }
+	// fill the padding after the directions are set
+	void Pad() {
+		for (int i = count; i < PaddedCount(); ++i) {
+			x[i] = x[count - 1];
+			y[i] = y[count - 1];
+			z[i] = z[count - 1];
+		}
+	}
+};
@@ -0,0 +1,179 @@
+#include "ltc_fit.h"
+#include "ltc_validate.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void PrintUsage()
+{
+	std::cout << "usage: ltc_fit [options]\n"
+		<< "  --resolution <n>   table size (theta, alpha), default 64\n"
+		<< "  --samples <n>      samples per axis of the error grid, default 50\n"
+		<< "  --min-alpha <f>    minimal roughness, default 0.0001\n"
+		<< "  --brdf <names>     comma separated, one table layer each: ggx, ggx-separable, disney-diffuse, sheen\n"
+		<< "  --isotropic        fit every cell with an isotropic lobe\n"
+		<< "  --output <path>    base name of the .dds files, default ltc\n"
+		<< "  --threads <n>      0: hardware concurrency, default 0\n"
+		<< "  --optimizer <name> nelder-mead (default) or bfgs\n"
+		<< "  --aniso <t>x<p>x<a> fit the 4D anisotropic GGX table of t theta, p phi and a^2 (alphaX, alphaY) cells\n"
+		<< "                     to <output>_aniso.dds instead, with --samples, --min-alpha, --threads and --optimizer\n"
+		<< "  --pack-half        also write <output>_packed.dds, both tables in one RGBA16F array\n"
+		<< "  --pack <path>      only pack the existing <path>.dds and <path>_amp.dds into <path>_packed.dds\n"
+		<< "  --embed <path>     only pack <path>.dds and <path>_amp.dds into the C++ header --output (ENGINE_EMBED_LTC_TABLE)\n"
+		<< "  --validate <path>  only validate <path>.dds against Monte Carlo, layer k with the k-th --brdf,\n"
+		<< "                     writes the error maps to <path>_rmse.png and <path>_max.png\n"
+		<< "  --validate-grid <n> (roughness, theta) cells to validate, default 16\n"
+		<< "  --max-rmse <f>     validate the table (the fitted one without --validate) and fail above this rmse\n";
+}
+
+static bool ParseBRDF(const std::string& name, BRDFModel& model)
+{
+	if (name == "ggx") { model = BRDFModel::GGX; return true; }
+	if (name == "ggx-separable") { model = BRDFModel::GGXSeparable; return true; }
+	if (name == "disney-diffuse") { model = BRDFModel::DisneyDiffuse; return true; }
+	if (name == "sheen") { model = BRDFModel::Sheen; return true; }
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	LTCFit::FitSettings settings;
+	std::string output = "ltc";
+	std::string pack_only;
+	std::string validate_only;
+	std::string embed_only;
+	LTCFit::ValidationSettings validation;
+	float max_rmse = -1.f;
+	LTCFit::AnisotropicFitSettings aniso;
+	bool anisotropic = false;
+	bool samples_set = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool has_value = true;
+		if (!strcmp(arg, "--isotropic")) { settings.isotropic = true; has_value = false; }
+		else if (!strcmp(arg, "--pack-half")) { settings.packHalf = true; has_value = false; }
+		else if (!value) { PrintUsage(); return 1; }
+		else if (!strcmp(arg, "--resolution")) settings.resolution = atoi(value);
+		else if (!strcmp(arg, "--samples")) { settings.sampleCount = atoi(value); samples_set = true; }
+		else if (!strcmp(arg, "--aniso")) {
+			anisotropic = true;
+			if (sscanf(value, "%dx%dx%d", &aniso.thetaCount, &aniso.phiCount, &aniso.alphaCount) != 3
+				|| aniso.thetaCount < 2 || aniso.phiCount < 1 || aniso.alphaCount < 2) {
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (!strcmp(arg, "--min-alpha")) settings.minAlpha = (float)atof(value);
+		else if (!strcmp(arg, "--output")) output = value;
+		else if (!strcmp(arg, "--threads")) settings.threadCount = (unsigned int)atoi(value);
+		else if (!strcmp(arg, "--pack")) pack_only = value;
+		else if (!strcmp(arg, "--optimizer")) {
+			if (!strcmp(value, "nelder-mead")) settings.optimizer = LTCFit::FitOptimizer::NelderMead;
+			else if (!strcmp(value, "bfgs")) settings.optimizer = LTCFit::FitOptimizer::BFGS;
+			else { std::cerr << "unknown optimizer: " << value << std::endl; return 1; }
+		}
+		else if (!strcmp(arg, "--validate")) validate_only = value;
+		else if (!strcmp(arg, "--embed")) embed_only = value;
+		else if (!strcmp(arg, "--validate-grid")) validation.gridSize = atoi(value);
+		else if (!strcmp(arg, "--max-rmse")) max_rmse = (float)atof(value);
+		else if (!strcmp(arg, "--brdf")) {
+			settings.brdfs.clear();
+			std::string names = value;
+			for (size_t begin = 0, end; begin <= names.size(); begin = end + 1) {
+				end = std::min(names.find(',', begin), names.size());
+				BRDFModel model;
+				if (!ParseBRDF(names.substr(begin, end - begin), model)) {
+					std::cerr << "unknown brdf: " << names.substr(begin, end - begin) << std::endl;
+					return 1;
+				}
+				settings.brdfs.push_back(model);
+			}
+		}
+		else { PrintUsage(); return 1; }
+		if (has_value) ++i;
+	}
+	if (settings.resolution < 2 || settings.sampleCount < 1 || settings.minAlpha <= 0.f || validation.gridSize < 2) {
+		PrintUsage();
+		return 1;
+	}
+
+	// Monte Carlo check of a table, fails when a layer is above max_rmse (when given)
+	auto validate = [&](const std::string& base) {
+		validation.minAlpha = settings.minAlpha;
+		validation.brdfs = settings.brdfs;
+		validation.threadCount = settings.threadCount;
+		LTCFit::ValidationReport validation_report = LTCFit::ValidateTable(base, validation, base);
+		if (!validation_report.loaded) return false;
+		bool passed = true;
+		for (size_t layer = 0; layer < validation_report.rmse.size(); ++layer) {
+			std::cout << "layer " << layer << " validation rmse " << validation_report.rmse[layer]
+				<< " max " << validation_report.maxError[layer] << std::endl;
+			if (max_rmse >= 0.f && validation_report.rmse[layer] > max_rmse) passed = false;
+		}
+		if (!passed) std::cout << "validation failed: rmse above " << max_rmse << std::endl;
+		return passed;
+	};
+
+	if (!pack_only.empty()) {
+		return LTCFit::PackTextures(pack_only) ? 0 : 1;
+	}
+	if (!embed_only.empty()) {
+		return LTCFit::EmbedTextures(embed_only, output) ? 0 : 1;
+	}
+	if (!validate_only.empty()) {
+		return validate(validate_only) ? 0 : 1;
+	}
+
+	if (anisotropic) {
+		if (samples_set) aniso.sampleCount = settings.sampleCount;
+		aniso.minAlpha = settings.minAlpha;
+		aniso.threadCount = settings.threadCount;
+		aniso.optimizer = settings.optimizer;
+		LTCFit::AnisotropicFitReport aniso_report = LTCFit::GenerateAnisotropicTexture(output, aniso);
+
+		const size_t cells = aniso_report.errors.size();
+		std::vector<float> sorted(aniso_report.errors);
+		std::sort(sorted.begin(), sorted.end());
+		long long evaluations = 0;
+		for (int count : aniso_report.evaluations) evaluations += count;
+		std::cout << "table " << aniso.thetaCount << "x" << aniso.phiCount << "x" << aniso.alphaCount << "x" << aniso.alphaCount
+			<< ", " << aniso.sampleCount << "^2 samples, " << aniso_report.seconds << " s (" << aniso_report.seconds * 1000.0 / cells
+			<< " ms per cell), " << aniso_report.bytes << " bytes (" << aniso_report.bytes / cells << " per cell)" << std::endl;
+		std::cout << "error median " << sorted[cells / 2] << " p95 " << sorted[cells * 95 / 100] << " max " << sorted.back()
+			<< ", " << (double)evaluations / cells << " evaluations per cell" << std::endl;
+		return 0;
+	}
+
+	LTCFit::FitReport report = LTCFit::GenerateTexture(output, settings);
+
+	// per cell error statistics of each layer, the worst cells are where a finer table or more samples help
+	const int N = settings.resolution;
+	std::cout << "table " << N << "x" << N << "x" << settings.brdfs.size() << ", " << settings.sampleCount << "^2 samples, "
+		<< report.seconds << " s (" << report.seconds * 1000.0 / (N * N * settings.brdfs.size()) << " ms per cell)" << std::endl;
+	for (size_t layer = 0; layer < settings.brdfs.size(); ++layer) {
+		auto begin = report.errors.begin() + layer * N * N;
+		std::vector<float> sorted(begin, begin + N * N);
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (float error : sorted) sum += error;
+		const int worst = (int)(std::max_element(begin, begin + N * N) - begin);
+		long long evaluations = 0;
+		for (int i = 0; i < N * N; ++i) evaluations += report.evaluations[layer * N * N + i];
+
+		std::cout << "layer " << layer << " error mean " << sum / sorted.size()
+			<< " median " << sorted[sorted.size() / 2]
+			<< " p95 " << sorted[sorted.size() * 95 / 100]
+			<< " max " << sorted.back()
+			<< " at (alpha " << worst % N << ", theta " << worst / N << ")"
+			<< ", " << (double)evaluations / (N * N) << " evaluations per cell" << std::endl;
+	}
+	if (max_rmse >= 0.f) {
+		return validate(output) ? 0 : 1;
+	}
+	return 0;
+}
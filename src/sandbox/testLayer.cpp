@@ -6,6 +6,10 @@
 
 #include "imgui.h"
 
+#ifdef ENGINE_EMBED_LTC_TABLE
+#include "ltcTable.h"
+#endif
+
 using namespace VK_Renderer;
 
 struct CameraUBO
@@ -44,10 +48,9 @@ void RenderLayer::OnAttach()
 	LoadScene();
 
 	// Generate textures
-	m_LightBlurTexture = mkU<VK_Texture2DArray>(*m_Device);
+	m_LightBlurTexture = mkU<VK_Texture2D>(*m_Device);
 	m_CompressedTexture = mkU<VK_Texture2DArray>(*m_Device);
 	m_DDSTexture = mkU<VK_Texture2D>(*m_Device);
-	m_DDSAmpFresnel = mkU<VK_Texture2D>(*m_Device);
 	GenTextures();
 
 	// Generate Buffers
@@ -99,6 +102,56 @@ void RenderLayer::OnUpdate(double const& deltaTime)
 		LightInfo updatedInfo = area_light.GetLightInfo();
 		m_LightBuffer->Update(&updatedInfo, sizeof(LightInfo) * id, sizeof(LightInfo));
 	}
+	if (b_AnimateLight)
+	{
+		m_LightAnimationTime += deltaTime;
+		if (m_LightAnimationTime >= m_NextLightFrameTime)
+		{
+			m_NextLightFrameTime = m_LightAnimationTime + LightFrameInterval;
+
+			// scrolling colour bands, the atlas resamples the frame to the block of the light
+			glm::ivec3 const resolution(64, 64, 4);
+			std::vector<unsigned char> frame(resolution.x * resolution.y * 4);
+			for (int y = 0; y < resolution.y; ++y)
+			{
+				for (int x = 0; x < resolution.x; ++x)
+				{
+					float phase = 6.2831853f * (static_cast<float>(x + y) / resolution.x - 0.5f * m_LightAnimationTime);
+					unsigned char* texel = frame.data() + (y * resolution.x + x) * 4;
+					texel[0] = static_cast<unsigned char>(127.5f + 127.5f * glm::sin(phase));
+					texel[1] = static_cast<unsigned char>(127.5f + 127.5f * glm::sin(phase + 2.0943951f));
+					texel[2] = static_cast<unsigned char>(127.5f + 127.5f * glm::sin(phase + 4.1887902f));
+					texel[3] = 255;
+				}
+			}
+			m_SceneLight->SubmitLightFrame(0, PixelView(frame.data(), static_cast<uint32_t>(frame.size()), resolution));
+		}
+	}
+	// lights given new frames through SubmitLightFrame, only their rectangles of the pyramid are uploaded
+	if (m_SceneLight->HasPendingLightFrames())
+	{
+		LightTextureUpdate light_update = m_SceneLight->UpdateLightTextures();
+		std::vector<vk::BufferImageCopy> regions;
+		for (LightTextureRegion const& region : light_update.regions)
+		{
+			regions.push_back(vk::BufferImageCopy{
+				.bufferOffset = region.dataOffset,
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = vk::ImageSubresourceLayers{
+					.aspectMask = vk::ImageAspectFlagBits::eColor,
+					.mipLevel = region.level,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				},
+				.imageOffset = { region.offset.x, region.offset.y, 0 },
+				.imageExtent = { static_cast<uint32_t>(region.extent.x), static_cast<uint32_t>(region.extent.y), 1 }
+			});
+		}
+		// the frames still in flight sample the texture, the copy has to wait for them
+		m_Engine->WaitForInFlightFrames();
+		m_LightBlurTexture->UpdateRegions(light_update.data.data(), light_update.data.size(), regions);
+	}
 	if (b_Play)
 	{
 		{
@@ -167,6 +220,7 @@ void RenderLayer::OnImGui(double const& deltaTime)
 	}
 	ImGui::Checkbox("Play", &b_Play);
 	ImGui::DragFloat("Play Speed", &m_PlaySpeed);
+	ImGui::Checkbox("Animate Light", &b_AnimateLight);
 	ImGui::End();
 
 	ImGui::Begin("Camera Window");
@@ -706,19 +760,32 @@ void RenderLayer::GenBuffers()
 void RenderLayer::GenTextures()
 {
 	
-	// Load dds image for LTC
-	m_DDSTexture->CreateFromFile("images/ltc.dds", { .format = vk::Format::eR32G32B32A32Sfloat, .usage = vk::ImageUsageFlagBits::eSampled });
+	// Load dds image for LTC, RGBA16F array with the inverse M terms in layer 0 and amplitude, fresnel in layer 1
+	// (ltc_fit --pack images/ltc)
+#ifdef ENGINE_EMBED_LTC_TABLE
+	// same texels compiled in, uploaded without reading and parsing the file. The extent comes from the
+	// table and mesh_ltc.frag reads it back with textureSize, so a table of any size can be embedded
+	m_DDSTexture->CreateFromData(LTCTable::Texels,
+		sizeof(LTCTable::Texels),
+		{
+			.width = LTCTable::Size,
+			.height = LTCTable::Size,
+			.depth = 1,
+		},
+		{
+			.format = vk::Format::eR16G16B16A16Sfloat,
+			.usage = vk::ImageUsageFlagBits::eSampled,
+			.arrayLayer = LTCTable::LayerCount
+		}
+	);
+#else
+	m_DDSTexture->CreateFromFile("images/ltc_packed.dds", { .usage = vk::ImageUsageFlagBits::eSampled });
+#endif
 	m_DDSTexture->TransitionLayout(VK_ImageLayout{
 		.layout = vk::ImageLayout::eShaderReadOnlyOptimal,
 		.accessFlag = vk::AccessFlagBits::eShaderRead,
 		.pipelineStage = vk::PipelineStageFlagBits::eFragmentShader,
 	});
-	m_DDSAmpFresnel->CreateFromFile("images/ltc_amp.dds", { .format = vk::Format::eR32G32Sfloat, .usage = vk::ImageUsageFlagBits::eSampled });
-	m_DDSAmpFresnel->TransitionLayout(VK_ImageLayout{
-	.layout = vk::ImageLayout::eShaderReadOnlyOptimal,
-	.accessFlag = vk::AccessFlagBits::eShaderRead,
-	.pipelineStage = vk::PipelineStageFlagBits::eFragmentShader,
-	});
 	
 	// Scene Compress textures
 	
@@ -732,7 +799,7 @@ void RenderLayer::GenTextures()
 		{
 			.format = vk::Format::eR8G8B8A8Unorm,
 			.usage = vk::ImageUsageFlagBits::eSampled,
-			.arrayLayer = 4
+			.arrayLayer = m_Scene->GetAtlasTex2D()->GetLayerCount()
 		}
 	);
 
@@ -742,20 +809,13 @@ void RenderLayer::GenTextures()
 		.pipelineStage = vk::PipelineStageFlagBits::eFragmentShader,
 	});
 
-	// light Blur textures
-	AtlasTexture2D compressedLightTex = m_SceneLight->GetLightTexture();
-	m_LightBlurTexture->CreateFromData(
-		compressedLightTex.GetData().data(),
-		compressedLightTex.GetSize(),
-		{
-			.width = static_cast<uint32_t>(compressedLightTex.GetResolution().x),
-			.height = static_cast<uint32_t>(compressedLightTex.GetResolution().y),
-			.depth = 1
-		},
+	// light Blur textures, prefiltered levels are the mips
+	AtlasTexture2D const& compressedLightTex = m_SceneLight->GetLightTexture();
+	Image lightPyramid = m_SceneLight->GetLightPyramid(compressedLightTex);
+	m_LightBlurTexture->CreateFromImage(lightPyramid,
 		{
 			.format = vk::Format::eR8G8B8A8Unorm,
-			.usage = vk::ImageUsageFlagBits::eSampled,
-			.arrayLayer = m_SceneLight->GetBlurLayerCount()
+			.usage = vk::ImageUsageFlagBits::eSampled
 		}
 	);
 
@@ -879,15 +939,6 @@ void RenderLayer::CreateDescriptors()
 				.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
 			}
 		},
-		VK_DescriptorBinding{
-			.type = vk::DescriptorType::eCombinedImageSampler,
-			.stage = vk::ShaderStageFlagBits::eFragment,
-			.imageInfo = vk::DescriptorImageInfo{
-			.sampler = m_DDSAmpFresnel->GetSampler(),
-			.imageView = m_DDSAmpFresnel->GetImageView(),
-			.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
-			}
-		},
 		VK_DescriptorBinding{
 			.type = vk::DescriptorType::eCombinedImageSampler,
 			.stage = vk::ShaderStageFlagBits::eFragment,
@@ -60,6 +60,11 @@ protected:
 	bool b_Play = false;
 	bool b_ShowImGui = true;
 	float m_PlaySpeed = 20.f;
+	// texture of the first light replaced by a generated frame every LightFrameInterval seconds
+	bool b_AnimateLight = false;
+	float m_LightAnimationTime = 0.f;
+	float m_NextLightFrameTime = 0.f;
+	static constexpr float LightFrameInterval = 1.f / 30.f;
 
 	VK_Renderer::VK_RenderEngine* m_Engine;
 	VK_Renderer::VK_Device const* m_Device;
@@ -69,9 +74,8 @@ protected:
 	uPtr<VK_Renderer::VK_CommandBuffer> m_Cmd;
 	
 	uPtr<VK_Renderer::VK_Texture2D> m_DDSTexture;	
-	uPtr<VK_Renderer::VK_Texture2D> m_DDSAmpFresnel;
 	uPtr<VK_Renderer::VK_Texture2DArray> m_CompressedTexture;
-	uPtr<VK_Renderer::VK_Texture2DArray> m_LightBlurTexture;
+	uPtr<VK_Renderer::VK_Texture2D> m_LightBlurTexture;
 
 	uPtr<VK_Renderer::VK_GraphicsPipeline> m_MeshShaderLightPipeline;
 
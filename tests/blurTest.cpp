@@ -0,0 +1,305 @@
+#include "testCommon.h"
+
+#include "scene/gaussianBlur.h"
+#include "scene/blurBackend.h"
+#include "core/threadPool.h"
+
+using namespace VK_Renderer;
+
+// deterministic RGBA8 pattern full of edges, same hash as BlurBackend::Compare
+static std::vector<unsigned char> HashImage(glm::ivec2 const& resolution)
+{
+	std::vector<unsigned char> image(static_cast<size_t>(resolution.x) * resolution.y * 4);
+	for (size_t i = 0; i < image.size(); ++i)
+	{
+		uint32_t h = static_cast<uint32_t>(i) * 2654435761u;
+		image[i] = static_cast<unsigned char>((h >> 13) ^ (h >> 24));
+	}
+	return image;
+}
+
+static int MaxDifference(std::vector<unsigned char> const& a, std::vector<unsigned char> const& b)
+{
+	int error = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		error = std::max(error, std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+	}
+	return error;
+}
+
+static std::vector<float> Kernel2D(std::vector<float> const& kernel)
+{
+	std::vector<float> kernel_2d(kernel.size() * kernel.size());
+	for (size_t y = 0; y < kernel.size(); ++y)
+	{
+		for (size_t x = 0; x < kernel.size(); ++x) kernel_2d[y * kernel.size() + x] = kernel[x] * kernel[y];
+	}
+	return kernel_2d;
+}
+
+static char const* BorderName(BlurBorder const& border)
+{
+	switch (border)
+	{
+	case BlurBorder::Clamp: return "clamp";
+	case BlurBorder::Mirror: return "mirror";
+	default: return "renormalize";
+	}
+}
+
+// weights sum to 1 and mirror exactly, for narrow, wide and truncated kernels
+static void TestGaussianKernel()
+{
+	for (float sigma : { 0.f, 0.3f, 0.5f, 1.f, 1.7f, 2.f, 4.5f, 10.f, 33.f })
+	{
+		for (int half_radius : { 0, 1, 3, static_cast<int>(std::ceil(3.f * sigma)), 64 })
+		{
+			std::vector<float> kernel = GetGaussianKernel1D(half_radius, sigma);
+			TEST_CHECK(kernel.size() == static_cast<size_t>(2 * half_radius + 1), "sigma %.1f radius %d: %zu weights",
+				sigma, half_radius, kernel.size());
+
+			double sum = 0.0;
+			bool symmetric = true;
+			for (size_t i = 0; i < kernel.size(); ++i)
+			{
+				sum += kernel[i];
+				symmetric = symmetric && kernel[i] == kernel[kernel.size() - 1 - i];
+			}
+			TEST_CHECK(std::abs(sum - 1.0) < 1e-6, "sigma %.1f radius %d: weights sum to %.9f", sigma, half_radius, sum);
+			TEST_CHECK(symmetric, "sigma %.1f radius %d: weights are not symmetric", sigma, half_radius);
+
+			std::shared_ptr<std::vector<float> const> cached = GetCachedGaussianKernel1D(half_radius, sigma);
+			TEST_CHECK(*cached == kernel, "sigma %.1f radius %d: cached kernel differs", sigma, half_radius);
+		}
+	}
+}
+
+// Reference of one texel of a blur along one axis, with the border rule written out instead of GetBorderIndex
+static float BlurTexel1D(std::vector<float> const& values, int const& x, std::vector<float> const& kernel, BlurBorder const& border)
+{
+	int size = static_cast<int>(values.size());
+	int half_radius = static_cast<int>(kernel.size()) / 2;
+	float sum = 0.f, weight = 0.f;
+	for (int k = -half_radius; k <= half_radius; ++k)
+	{
+		int i = x + k;
+		if (i < 0 || i >= size)
+		{
+			if (border == BlurBorder::Renormalize) continue;
+			if (border == BlurBorder::Clamp) i = (i < 0 ? 0 : size - 1);
+			// mirror with the edge texel repeated: -1 -> 0, -2 -> 1, size -> size - 1
+			else i = (i < 0 ? -i - 1 : 2 * size - 1 - i);
+		}
+		sum += kernel[k + half_radius] * values[i];
+		weight += kernel[k + half_radius];
+	}
+	return sum / weight;
+}
+
+// Constant images stay constant under every border, a step next to the border gives each mode its own
+// values there. Both blurs are checked against BlurTexel1D along the axis the image varies on.
+static void TestBorderModes(MyCore::ThreadPool& pool)
+{
+	int const half_radius = 6;
+	std::vector<float> kernel = GetGaussianKernel1D(half_radius, 3.f);
+	std::vector<float> kernel_2d = Kernel2D(kernel);
+	glm::ivec2 const resolution(40, 24);
+
+	// profiles along the axis, 0: constant, 1: step two texels from the first edge and a ramp before the last
+	auto profile = [](int const& shape, int const& i, int const& size) {
+		if (shape == 0) return 77.f;
+		if (i < 2) return 200.f;
+		return (i >= size - 4 ? 20.f + 50.f * (i - size + 4) : 20.f);
+	};
+
+	std::vector<unsigned char> input(static_cast<size_t>(resolution.x) * resolution.y * 4);
+	std::vector<unsigned char> separable(input.size()), full(input.size());
+	for (int shape = 0; shape < 2; ++shape)
+	{
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			int size = resolution[axis];
+			std::vector<float> values(size);
+			for (int i = 0; i < size; ++i) values[i] = profile(shape, i, size);
+			for (int y = 0; y < resolution.y; ++y)
+			{
+				for (int x = 0; x < resolution.x; ++x)
+				{
+					unsigned char value = static_cast<unsigned char>(values[axis == 0 ? x : y]);
+					for (int c = 0; c < 4; ++c) input[(static_cast<size_t>(y) * resolution.x + x) * 4 + c] = value;
+				}
+			}
+
+			for (BlurBorder border : { BlurBorder::Renormalize, BlurBorder::Clamp, BlurBorder::Mirror })
+			{
+				GaussianBlurSeparable(separable.data(), input.data(), resolution, half_radius, kernel.data(), pool, border);
+				GaussianBlur2D(full.data(), input.data(), resolution, half_radius, kernel_2d.data(), border);
+
+				int error = 0;
+				for (int y = 0; y < resolution.y; ++y)
+				{
+					for (int x = 0; x < resolution.x; ++x)
+					{
+						int i = (axis == 0 ? x : y);
+						// the texels whose kernel reaches past an edge
+						if (i > half_radius && i < size - 1 - half_radius) continue;
+						int expected = static_cast<int>(BlurTexel1D(values, i, kernel, border) + 0.5f);
+						size_t t = (static_cast<size_t>(y) * resolution.x + x) * 4;
+						for (int c = 0; c < 4; ++c)
+						{
+							error = std::max(error, std::abs(separable[t + c] - expected));
+							error = std::max(error, std::abs(full[t + c] - expected));
+						}
+					}
+				}
+				TEST_CHECK(error <= 1, "%s image along %c, %s: border texels off by %d",
+					shape == 0 ? "constant" : "step", axis == 0 ? 'x' : 'y', BorderName(border), error);
+			}
+		}
+	}
+}
+
+// GaussianBlur2D is the oracle of the separable blur, borders and odd sizes included
+static void TestSeparableMatches2D(MyCore::ThreadPool& pool)
+{
+	glm::ivec2 const resolutions[] = { { 67, 45 }, { 1, 9 }, { 13, 1 }, { 300, 7 } };
+	int const half_radii[] = { 1, 4, 8, 16 };
+	for (glm::ivec2 const& resolution : resolutions)
+	{
+		std::vector<unsigned char> input = HashImage(resolution);
+		std::vector<unsigned char> reference(input.size()), separable(input.size());
+		for (int half_radius : half_radii)
+		{
+			std::vector<float> kernel = GetGaussianKernel1D(half_radius, half_radius / 2.f);
+			std::vector<float> kernel_2d = Kernel2D(kernel);
+			for (BlurBorder border : { BlurBorder::Renormalize, BlurBorder::Clamp, BlurBorder::Mirror })
+			{
+				GaussianBlur2D(reference.data(), input.data(), resolution, half_radius, kernel_2d.data(), border);
+				GaussianBlurSeparable(separable.data(), input.data(), resolution, half_radius, kernel.data(), pool, border);
+				int error = MaxDifference(reference, separable);
+				TEST_CHECK(error <= 1, "%dx%d radius %d %s: separable differs from 2D by %d",
+					resolution.x, resolution.y, half_radius, BorderName(border), error);
+			}
+		}
+	}
+}
+
+// the CUDA backend must match the CPU backend within MaxConformanceError, or Create silently falls back
+static void TestBackendConformance()
+{
+	if (!BlurBackend::IsAvailable(BlurBackendType::CUDA))
+	{
+		std::printf("CUDA blur backend not built, conformance test skipped\n");
+		return;
+	}
+#ifdef ENGINE_WITH_CUDA
+	CPUBlurBackend cpu_backend;
+	CUDABlurBackend cuda_backend;
+	glm::ivec2 const resolutions[] = { { 67, 45 }, { 256, 256 }, { 1, 31 }, { 509, 3 } };
+	for (glm::ivec2 const& resolution : resolutions)
+	{
+		for (int half_radius : { 1, 8, 24 })
+		{
+			int error = BlurBackend::Compare(cpu_backend, cuda_backend, resolution, half_radius, half_radius / 2.f);
+			TEST_CHECK(error <= BlurBackend::MaxConformanceError, "%dx%d radius %d: CUDA differs from CPU by %d",
+				resolution.x, resolution.y, half_radius, error);
+		}
+	}
+	uPtr<BlurBackend> backend = BlurBackend::Create(BlurBackendType::CUDA);
+	TEST_CHECK(backend->GetType() == BlurBackendType::CUDA, "Create fell back to the CPU backend");
+#endif
+}
+
+// vertical edge from 0 to 255 in the middle, its blur is the Gaussian CDF across the edge
+static std::vector<unsigned char> StepImage(glm::ivec2 const& resolution)
+{
+	std::vector<unsigned char> image(static_cast<size_t>(resolution.x) * resolution.y * 4);
+	for (int y = 0; y < resolution.y; ++y)
+	{
+		for (int x = 0; x < resolution.x; ++x)
+		{
+			for (int c = 0; c < 4; ++c) image[(static_cast<size_t>(y) * resolution.x + x) * 4 + c] = (x < resolution.x / 2 ? 0 : 255);
+		}
+	}
+	return image;
+}
+
+// The box cascade against the separable Gaussian of the same sigma (kernel out to 3 sigma), on an edge and
+// on noise. Errors are in 8 bit levels and printed per sigma along with the time of both blurs.
+static void TestBoxCascadeAccuracy(MyCore::ThreadPool& pool)
+{
+	glm::ivec2 const resolution(256, 256);
+	std::vector<unsigned char> const inputs[] = { StepImage(resolution), HashImage(resolution) };
+	std::vector<unsigned char> gaussian(inputs[0].size()), box(inputs[0].size());
+	// measured max errors plus one level. Below sigma 2 the odd box widths can't reach the variance
+	// (sigma 1 gets radii 0 0 1, a variance of 0.67), so the bounds only guard against regressions there.
+	struct Bound { float sigma; int edge; int noise; };
+	Bound const bounds[] = { { 1.f, 16, 36 }, { 2.f, 5, 10 }, { 3.f, 4, 6 }, { 5.f, 2, 4 }, { 8.f, 3, 3 }, { 12.f, 3, 3 } };
+	for (Bound const& bound : bounds)
+	{
+		float const sigma = bound.sigma;
+		int half_radius = static_cast<int>(std::ceil(3.f * sigma));
+		std::vector<float> kernel = GetGaussianKernel1D(half_radius, sigma);
+		std::array<int, 3> radii = GetBoxCascadeRadii(sigma);
+
+		int max_error[2] = { 0, 0 };
+		double rms_error[2] = { 0.0, 0.0 };
+		for (int i = 0; i < 2; ++i)
+		{
+			GaussianBlurSeparable(gaussian.data(), inputs[i].data(), resolution, half_radius, kernel.data(), pool);
+			BoxBlurCascade(box.data(), inputs[i].data(), resolution, sigma, pool);
+			max_error[i] = MaxDifference(gaussian, box);
+			for (size_t t = 0; t < box.size(); ++t)
+			{
+				double difference = static_cast<double>(gaussian[t]) - box[t];
+				rms_error[i] += difference * difference;
+			}
+			rms_error[i] = std::sqrt(rms_error[i] / box.size());
+		}
+
+		double time_gaussian = MeasureMs([&]() {
+			GaussianBlurSeparable(gaussian.data(), inputs[1].data(), resolution, half_radius, kernel.data(), pool);
+		});
+		double time_box = MeasureMs([&]() {
+			BoxBlurCascade(box.data(), inputs[1].data(), resolution, sigma, pool);
+		});
+		std::printf("box cascade sigma %4.1f radii %d %d %d: edge max %2d rms %.2f, noise max %2d rms %.2f, "
+			"gaussian %6.2f ms, box %5.2f ms\n", sigma, radii[0], radii[1], radii[2],
+			max_error[0], rms_error[0], max_error[1], rms_error[1], time_gaussian, time_box);
+
+		TEST_CHECK(max_error[0] <= bound.edge, "sigma %.1f: box cascade edge error %d", sigma, max_error[0]);
+		TEST_CHECK(max_error[1] <= bound.noise, "sigma %.1f: box cascade noise error %d", sigma, max_error[1]);
+	}
+}
+
+static void BenchmarkSeparable(MyCore::ThreadPool& pool)
+{
+	glm::ivec2 const resolution(512, 512);
+	std::vector<unsigned char> input = HashImage(resolution), output(input.size());
+	for (int half_radius : { 4, 8 })
+	{
+		std::vector<float> kernel = GetGaussianKernel1D(half_radius, half_radius / 2.f);
+		std::vector<float> kernel_2d = Kernel2D(kernel);
+		double time_2d = MeasureMs([&]() {
+			GaussianBlur2D(output.data(), input.data(), resolution, half_radius, kernel_2d.data());
+		}, 1);
+		double time_separable = MeasureMs([&]() {
+			GaussianBlurSeparable(output.data(), input.data(), resolution, half_radius, kernel.data(), pool);
+		});
+		std::printf("512x512 radius %2d: 2D %8.2f ms, separable %6.2f ms (%u threads)\n",
+			half_radius, time_2d, time_separable, pool.GetThreadCount());
+	}
+}
+
+int main()
+{
+	MyCore::ThreadPool pool;
+	TestGaussianKernel();
+	TestSeparableMatches2D(pool);
+	TestBorderModes(pool);
+	TestBackendConformance();
+	TestBoxCascadeAccuracy(pool);
+	BenchmarkSeparable(pool);
+	return TestResult("blurTest");
+}
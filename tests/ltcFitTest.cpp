@@ -0,0 +1,205 @@
+#include "testCommon.h"
+
+#include "ltc_fit.h"
+#include "halfFloat.h"
+
+#include <dds.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace LTCFit;
+
+// The batched error (BRDFSamples, SIMD lanes, per thread scratch buffers) against ComputeErrorReference, one
+// sample at a time, for random BRDF models, view angles, roughness and LTC parameters
+static void TestBatchedErrorMatchesReference()
+{
+	int const sample_count = 32;
+	float const min_alpha = FitSettings().minAlpha;
+	BRDFModel const models[] = { BRDFModel::GGX, BRDFModel::GGXSeparable, BRDFModel::DisneyDiffuse, BRDFModel::Sheen };
+	char const* const model_names[] = { "ggx", "ggx-separable", "disney-diffuse", "sheen" };
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	float max_relative_error = 0.f;
+	for (int cell = 0; cell < 64; ++cell)
+	{
+		int model = cell % 4;
+		std::unique_ptr<BRDF> brdf = CreateBRDF(models[model]);
+		float theta = 1.57f * unit(rng);
+		float roughness = unit(rng);
+		float alpha = std::max(roughness * roughness, min_alpha);
+		glm::vec3 const V(sinf(theta), 0.f, cosf(theta));
+
+		// frame and amplitude as FitCell sets them, then any lobe the optimizer could try
+		BRDFSamples brdf_samples(*brdf, V, alpha, sample_count);
+		LTC ltc;
+		glm::vec3 avg_dir;
+		ComputeAverageValues(brdf_samples, V, avg_dir, ltc.m_amplitude, ltc.m_fresnel);
+		glm::vec3 Z = glm::normalize(avg_dir);
+		ltc.X = glm::vec3(Z.z, 0.f, -Z.x);
+		ltc.Y = glm::vec3(0.f, 1.f, 0.f);
+		ltc.Z = Z;
+		float params[3] = { 0.05f + 1.5f * unit(rng), 0.05f + 1.5f * unit(rng), unit(rng) - 0.5f };
+		SetFitParameters(ltc, params, false, min_alpha);
+
+		float batched = ComputeError(ltc, *brdf, brdf_samples, V, alpha);
+		float reference = ComputeErrorReference(ltc, *brdf, V, alpha, sample_count);
+		float relative_error = std::abs(batched - reference) / std::max(std::abs(reference), 1e-6f);
+		max_relative_error = std::max(max_relative_error, relative_error);
+		TEST_CHECK(relative_error < 1e-4f, "%s theta %.3f alpha %.4f: batched %g, reference %g",
+			model_names[model], theta, alpha, batched, reference);
+	}
+	std::printf("batched error vs reference: max relative difference %.2e over 64 cells\n", max_relative_error);
+}
+
+static std::vector<char> ReadBytes(std::string const& file)
+{
+	std::ifstream in(file, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Cells are warm started from their neighbours in a fixed order whatever the thread count, so the table
+// written on several threads must be the serial one byte for byte
+static void TestThreadCountDeterministic()
+{
+	std::string const base = (std::filesystem::temp_directory_path() / "ltcFitTest_threads").string();
+	FitSettings settings;
+	settings.resolution = 16;
+	settings.sampleCount = 32;
+	std::vector<char> tables[2], amplitudes[2];
+	unsigned int const thread_counts[2] = { 1, 4 };
+	for (int i = 0; i < 2; ++i)
+	{
+		settings.threadCount = thread_counts[i];
+		std::string const file = base + std::to_string(thread_counts[i]);
+		GenerateTexture(file, settings);
+		tables[i] = ReadBytes(file + ".dds");
+		amplitudes[i] = ReadBytes(file + "_amp.dds");
+	}
+	TEST_CHECK(tables[0].size() > 0 && tables[0] == tables[1], "table on 4 threads differs from the serial one");
+	TEST_CHECK(amplitudes[0].size() > 0 && amplitudes[0] == amplitudes[1], "amplitude table on 4 threads differs from the serial one");
+	std::printf("16x16 table on 1 and 4 threads: %s\n", (tables[0] == tables[1] && amplitudes[0] == amplitudes[1] ? "identical" : "different"));
+}
+
+// inverse M scaled to a determinant of 1, the scale the anisotropic table is stored with
+static glm::mat3 NormalizeDeterminant(glm::mat3 const& invM)
+{
+	glm::mat3 normalized = invM;
+	normalized /= cbrtf(glm::determinant(invM));
+	return normalized;
+}
+
+// With alphaX == alphaY the anisotropic GGX is isotropic, so its cell at (theta, phi) is the 2D fit at theta
+// rotated by phi about the normal. Both tables are fitted on the same grid and their matrices compared.
+static void TestAnisotropicMatchesRotated2D()
+{
+	int const N = 8, phi_count = 4;
+	std::string const base = (std::filesystem::temp_directory_path() / "ltcFitTest").string();
+
+	FitSettings settings;
+	settings.resolution = N;
+	settings.sampleCount = 32;
+	FitReport report_2d = GenerateTexture(base, settings);
+	AnisotropicFitSettings aniso_settings;
+	aniso_settings.thetaCount = N;
+	aniso_settings.phiCount = phi_count;
+	aniso_settings.alphaCount = N;
+	aniso_settings.sampleCount = 32;
+	AnisotropicFitReport report_aniso = GenerateAnisotropicTexture(base, aniso_settings);
+
+	DDSImage table_2d = LoadDDS((base + ".dds").c_str());
+	DDSImage table_aniso = LoadDDS((base + "_aniso.dds").c_str());
+	TEST_CHECK(table_2d.data.size() == sizeof(float) * 4 * N * N, "2D table of %zu bytes", table_2d.data.size());
+	TEST_CHECK(table_aniso.data.size() == report_aniso.bytes, "anisotropic table of %zu bytes", table_aniso.data.size());
+	if (table_2d.data.size() != sizeof(float) * 4 * N * N || table_aniso.data.size() != report_aniso.bytes) return;
+	float const* terms_2d = reinterpret_cast<float const*>(table_2d.data.data());
+	uint16_t const* texels = reinterpret_cast<uint16_t const*>(table_aniso.data.data());
+
+	for (int p = 0; p < phi_count; ++p)
+	{
+		float const phi = p / (float)(phi_count - 1) * 1.57079f;
+		// rotation by phi about z, M of the rotated lobe is R M so its inverse is invM R^T
+		glm::mat3 const rotation(glm::vec3(cosf(phi), sinf(phi), 0.f), glm::vec3(-sinf(phi), cosf(phi), 0.f), glm::vec3(0.f, 0.f, 1.f));
+		float max_difference = 0.f, max_error_ratio = 0.f;
+		// the roughest cells, below alpha 0.05 both fits hit minAlpha and their error is noise
+		for (int a = 2; a < N; ++a)
+		{
+			for (int t = 0; t < N; ++t)
+			{
+				float const* terms = terms_2d + 4 * (a + t * N);
+				glm::mat3 const invM_2d(glm::vec3(terms[0], 0.f, terms[2]), glm::vec3(0.f, 1.f, 0.f), glm::vec3(terms[1], 0.f, terms[3]));
+				glm::mat3 const expected = NormalizeDeterminant(invM_2d * glm::transpose(rotation));
+
+				float values[12];
+				for (int k = 0; k < 3; ++k)
+				{
+					uint16_t const* texel = texels + 4 * ((3 * (t + N * p) + k) * N * N + a + N * a);
+					for (int c = 0; c < 4; ++c) values[4 * k + c] = VK_Renderer::HalfToFloat(texel[c]);
+				}
+				// stored as mRowColumn: m00 m01 m02 m10 m11 m12 m20 m21 m22
+				glm::mat3 invM;
+				for (int row = 0; row < 3; ++row)
+				{
+					for (int column = 0; column < 3; ++column) invM[column][row] = values[3 * row + column];
+				}
+				// at normal incidence the lobe is symmetric about z and any rotation of it about z is the same
+				// distribution, only invM^T invM is fixed there
+				glm::mat3 const compared = (t == 0 ? glm::transpose(invM) * invM : invM);
+				glm::mat3 const reference = (t == 0 ? glm::transpose(expected) * expected : expected);
+				for (int column = 0; column < 3; ++column)
+				{
+					for (int row = 0; row < 3; ++row)
+					{
+						float const difference = std::abs(compared[column][row] - reference[column][row]);
+						max_difference = std::max(max_difference, difference / std::max(1.f, std::abs(reference[column][row])));
+					}
+				}
+
+				int const cell = t + N * (p + phi_count * (a + N * a));
+				float const error_2d = std::max(report_2d.errors[a + t * N], 1e-6f);
+				max_error_ratio = std::max(max_error_ratio, report_aniso.errors[cell] / error_2d);
+			}
+		}
+		std::printf("alphaX == alphaY, phi %.2f: max relative difference to the rotated 2D fit %.3f, error up to %.2fx the 2D fit\n",
+			phi, max_difference, max_error_ratio);
+		TEST_CHECK(max_difference < 0.05f, "phi %.2f: inverse M differs from the rotated 2D fit by %f", phi, max_difference);
+		TEST_CHECK(max_error_ratio < 1.5f, "phi %.2f: error %.2fx the 2D fit", phi, max_error_ratio);
+	}
+}
+
+// time of one error evaluation inside a fit, where the BRDF samples of the cell are already built
+static void BenchmarkError()
+{
+	int const sample_count = FitSettings().sampleCount;
+	int const repeat = 200;
+	std::unique_ptr<BRDF> brdf = CreateBRDF(BRDFModel::GGX);
+	float const theta = 0.8f, alpha = 0.25f;
+	glm::vec3 const V(sinf(theta), 0.f, cosf(theta));
+
+	BRDFSamples brdf_samples(*brdf, V, alpha, sample_count);
+	LTC ltc;
+	glm::vec3 avg_dir;
+	ComputeAverageValues(brdf_samples, V, avg_dir, ltc.m_amplitude, ltc.m_fresnel);
+	float params[3] = { 0.4f, 0.5f, 0.1f };
+	SetFitParameters(ltc, params, false, FitSettings().minAlpha);
+
+	volatile float sink = 0.f;
+	double time_batched = MeasureMs([&]() {
+		for (int i = 0; i < repeat; ++i) sink = sink + ComputeError(ltc, *brdf, brdf_samples, V, alpha);
+	});
+	double time_reference = MeasureMs([&]() {
+		for (int i = 0; i < repeat; ++i) sink = sink + ComputeErrorReference(ltc, *brdf, V, alpha, sample_count);
+	});
+	std::printf("error of a %dx%d grid: batched %.1f us, reference %.1f us, %.1fx\n", sample_count, sample_count,
+		1000.0 * time_batched / repeat, 1000.0 * time_reference / repeat, time_reference / time_batched);
+}
+
+int main()
+{
+	TestBatchedErrorMatchesReference();
+	TestThreadCountDeterministic();
+	TestAnisotropicMatchesRotated2D();
+	BenchmarkError();
+	return TestResult("ltcFitTest");
+}
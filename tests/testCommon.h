@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Minimal checks for the test executables, a failed check is printed and the test returns 1 from main
+inline int g_FailedChecks = 0;
+
+#define TEST_CHECK(condition, ...) \
+	do { \
+		if (!(condition)) { \
+			++g_FailedChecks; \
+			std::printf("%s:%d: failed: %s: ", __FILE__, __LINE__, #condition); \
+			std::printf(__VA_ARGS__); \
+			std::printf("\n"); \
+		} \
+	} while (0)
+
+// Best time of repeat runs of func in milliseconds
+template<typename Func>
+double MeasureMs(Func&& func, int const& repeat = 3)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeat; ++i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		func();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+inline int TestResult(char const* name)
+{
+	if (g_FailedChecks > 0) std::printf("%s: %d checks failed\n", name, g_FailedChecks);
+	else std::printf("%s: passed\n", name);
+	return g_FailedChecks > 0 ? 1 : 0;
+}